@@ -27,31 +27,213 @@
  *     v1.0 - First release
  */
 
-#include "Arduino.h"
-#include <Wire.h>
-
 #include "Adafruit_LTR390.h"
+#include "Adafruit_LTR390_Trace.h"
+
+#if defined(ARDUINO)
+static uint32_t default_millis(void *) { return millis(); }
+static uint32_t default_micros(void *) { return micros(); }
+static void default_delay(void *, uint32_t ms) { delay(ms); }
+#else
+#include <chrono>
+#include <thread>
+
+static uint32_t default_millis(void *) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static uint32_t default_micros(void *) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static void default_delay(void *, uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+#endif
+
+#define LTR390_TIMED_BUS (LTR390_BUS_STATS || LTR390_BUS_HISTOGRAM)
+
+// The symbol files built with other flag values fail to link against
+const char LTR390_CONFIG_SYMBOL(LTR390_BUS_STATS, LTR390_BUS_HISTOGRAM) = 0;
+
+#define LTR390_OP(op) OpScope opscope(this, op) ///< Lock and attribute
+
+static const ltr390_clock_t default_clock = {default_millis, default_micros,
+                                             default_delay, NULL};
+
+// THRESH_UP and THRESH_LOW after power-on, from the datasheet
+static const uint8_t default_thresholds[6] = {0xFF, 0xFF, 0x0F,
+                                              0x00, 0x00, 0x00};
+
+// The read cache assumes the sensor's oscillator is within 1/8 of nominal
+#define LTR390_PERIOD_TOLERANCE 8
 
 /*!
  *    @brief  Instantiates a new LTR390 class
  */
-Adafruit_LTR390::Adafruit_LTR390(void) {}
+Adafruit_LTR390::Adafruit_LTR390(void)
+    : _mode(LTR390_MODE_ALS), _gain(LTR390_GAIN_3),
+      _resolution(LTR390_RESOLUTION_18BIT), _underflow(0),
+      _configChanged(LTR390_STALE_READINGS), _status(0),
+      _restorePending(false), _powerOns(0), _readCache(false),
+      _cacheValid(false), _phaseValid(false), _noDataValid(false),
+      _cacheAt(0), _statusAt(0), _noDataAt(0), _phaseLow(0), _phaseHigh(0),
+      _cacheHits(0), _phaseSkip(0), _snapSeq(0), _darkOffset(0), _read(NULL),
+      _write(NULL), _context(NULL), _clock(default_clock), _trace(NULL),
+      _lastStatus(LTR390_OK), _retryAttempt(0), _retryAt(0) {
+  memset(_darkOffsets, 0, sizeof(_darkOffsets));
+  memset(&_snapshot, 0, sizeof(_snapshot));
+  shadowDefaults();
+  _retryPolicy.maxRetries = 3;
+  _retryPolicy.baseDelayMs = 2;
+  _retryPolicy.maxDelayMs = 50;
+  resetRetryStats();
+  _op = LTR390_OP_NONE;
+  _depth = 0;
+  _busLock.lock = NULL;
+  _busLock.unlock = NULL;
+  _busLock.context = NULL;
+  _holdStart = 0;
+  _callHold = 0;
+  resetLockStats();
+#if LTR390_BUS_STATS
+  resetBusStats();
+#endif
+#if LTR390_BUS_HISTOGRAM
+  resetBusHistogram();
+#endif
+}
 
+#if defined(ARDUINO)
 /*!
  *    @brief  Setups the hardware for talking to the LTR390
  *    @param  theWire An optional pointer to an I2C interface
  *    @return True if initialization was successful, otherwise false.
  */
 bool Adafruit_LTR390::begin(TwoWire *theWire) {
-  i2c_dev = new Adafruit_I2CDevice(LTR390_I2CADDR_DEFAULT, theWire);
+  return begin(theWire, LTR390_I2CADDR_DEFAULT);
+}
+
+/*!
+ *    @brief  Setups the hardware for talking to the LTR390 at an address and
+ *            bus clock. The clock is tried first, then each slower standard
+ *            clock (1MHz, 400kHz, 100kHz) until the sensor reads back
+ *            correctly. Note this sets the clock of the whole bus
+ *    @param  theWire A pointer to an I2C interface
+ *    @param  addr The I2C address, the LTR390 is always at 0x53 but an
+ *            address translator can move it
+ *    @param  frequency Bus clock in Hz, 0 to leave the clock alone
+ *    @return True if initialization was successful, otherwise false.
+ */
+bool Adafruit_LTR390::begin(TwoWire *theWire, uint8_t addr,
+                            uint32_t frequency) {
+  LTR390_OP(LTR390_OP_BEGIN);
+  if (i2c_dev) {
+    delete i2c_dev;
+  }
+  i2c_dev = new Adafruit_I2CDevice(addr, theWire);
+  _busHz = 0;
+  // the speed probe goes through readRegister(), so it is counted and traced
+  _read = i2cRead;
+  _write = i2cWrite;
+  _context = i2c_dev;
 
   if (!i2c_dev->begin()) {
     return false;
   }
 
-  // check part ID!
-  Adafruit_I2CRegister idreg = Adafruit_I2CRegister(i2c_dev, LTR390_PART_ID);
-  if ((idreg.read() >> 4) != 0xB) {
+  if (frequency) {
+    static const uint32_t speeds[] = {1000000, 400000, 100000};
+    bool found = probeSpeed(frequency);
+    for (uint8_t i = 0; !found && (i < sizeof(speeds) / sizeof(speeds[0]));
+         i++) {
+      if (speeds[i] < frequency) {
+        found = probeSpeed(speeds[i]);
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+
+  return begin(i2cRead, i2cWrite, i2c_dev);
+}
+
+/*!
+ *    @brief  Get the bus clock begin() settled on
+ *    @return Clock in Hz, 0 if begin() left the clock alone
+ */
+uint32_t Adafruit_LTR390::busFrequency(void) { return _busHz; }
+
+/*!
+ *    @brief  Set the I2C device whose bus reset() re-begins, for a driver
+ *            on a custom transport that still runs over Wire. Not needed
+ *            after begin(TwoWire), and Adafruit_LTR390_Mux sets its own
+ *    @param  dev Any device on the sensor's bus, or NULL for none. Must
+ *            outlive the driver
+ */
+void Adafruit_LTR390::setBusDevice(Adafruit_I2CDevice *dev) { _busDev = dev; }
+
+/*!
+ *    @brief  Switch the bus clock and check the part ID reads back right a
+ *            few times in a row, as marginal edges fail intermittently
+ *    @param  frequency Bus clock in Hz
+ *    @return True if the clock was accepted and every read was good
+ */
+bool Adafruit_LTR390::probeSpeed(uint32_t frequency) {
+  if (!i2c_dev->setSpeed(frequency)) {
+    return false;
+  }
+  for (uint8_t i = 0; i < 4; i++) {
+    uint8_t partid;
+    if (!readRegister(LTR390_PART_ID, &partid, 1) ||
+        ((partid >> 4) != 0xB)) {
+      return false;
+    }
+  }
+  _busHz = frequency;
+  return true;
+}
+#endif
+
+/*!
+ *    @brief  Setups the LTR390 on any bus, through a pair of register
+ *            access functions. beginTransport() builds these for any class
+ *            with read(reg, buf, n) and write(reg, buf, n) methods
+ *    @param  readfn Reads n bytes starting at a register
+ *    @param  writefn Writes n bytes starting at a register
+ *    @param  context Passed through to readfn and writefn
+ *    @return True if initialization was successful, otherwise false.
+ */
+bool Adafruit_LTR390::begin(ltr390_read_fn readfn, ltr390_write_fn writefn,
+                            void *context) {
+  LTR390_OP(LTR390_OP_BEGIN);
+  _read = readfn;
+  _write = writefn;
+  _context = context;
+
+  // check part ID! retried, in case the bus is noisy. Unlike poll() this
+  // sleeps through the backoff, see setRetryPolicy()
+  uint8_t partid;
+  uint32_t backoff = _retryPolicy.baseDelayMs;
+  for (uint8_t attempt = 0; !readRegister(LTR390_PART_ID, &partid, 1);
+       attempt++) {
+    _retryStats.errors++;
+    if (attempt >= _retryPolicy.maxRetries) {
+      _retryStats.exhausted++;
+      return false;
+    }
+    busDelay(backoff);
+    backoff = (backoff * 2 > _retryPolicy.maxDelayMs)
+                  ? _retryPolicy.maxDelayMs
+                  : backoff * 2;
+    _retryStats.retries++;
+  }
+  if ((partid >> 4) != 0xB) {
     return false;
   }
 
@@ -66,65 +248,868 @@ bool Adafruit_LTR390::begin(TwoWire *theWire) {
     return false;
   }
 
-  StatusReg = new Adafruit_I2CRegister(i2c_dev, LTR390_MAIN_STATUS);
-  DataReadyBit = new Adafruit_I2CRegisterBits(StatusReg, 1, 3);
-
   return true;
 }
 
 /*!
- *  @brief  Perform a soft reset with 10ms delay.
+ *  @brief  Perform a soft reset with 10ms delay. The power-on flag the
+ *  reset sets is read and dropped, so it isn't counted as a brownout
  *  @returns True on success (reset bit was cleared post-write)
  */
 bool Adafruit_LTR390::reset(void) {
-  Adafruit_I2CRegister mainreg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_MAIN_CTRL);
-  Adafruit_I2CRegisterBits softreset =
-      Adafruit_I2CRegisterBits(&mainreg, 1, 4); // # bits, bit_shift
-
+  LTR390_OP(LTR390_OP_RESET);
   // this write will fail because it resets before acking?
-  softreset.write(1);
-  delay(10);
+  writeBits(LTR390_MAIN_CTRL, 1, 4, 1); // # bits, bit_shift
+  busDelay(10);
 
+#if defined(ARDUINO)
   // Missing ACK from above soft-reset cause permanent bus issue with
   // port such as nRF52, RP2040. Re-init I2C peripherals is required for
-  // recovery
-  i2c_dev->end();
-  i2c_dev->begin();
+  // recovery, also behind a mux or other transport over the same Wire
+  Adafruit_I2CDevice *dev = _busDev;
+  if (i2c_dev && (_context == i2c_dev)) {
+    dev = i2c_dev;
+  }
+  if (dev) {
+    dev->end();
+    dev->begin();
+    if (_busHz) { // some cores go back to 100kHz
+      dev->setSpeed(_busHz);
+    }
+  }
+#endif
 
   // however it does reset, check that the value is zero
-  if (softreset.read()) {
+  if (readBits(LTR390_MAIN_CTRL, 1, 4)) {
+    return false;
+  }
+  // the reset sets the power-on flag, read it so it isn't taken for a brownout
+  uint8_t status;
+  if (!readRegister(LTR390_MAIN_STATUS, &status, 1)) {
+    return false;
+  }
+  _status = 0;
+
+  shadowDefaults();
+  dropCache();
+  _restorePending = false;
+  // power-on defaults
+  _mode = LTR390_MODE_ALS;
+  _gain = LTR390_GAIN_3;
+  _resolution = LTR390_RESOLUTION_18BIT;
+  _configChanged = LTR390_STALE_READINGS;
+  updateDarkOffset();
+  return true;
+}
+
+/*!
+ *  @brief  Write the last configuration back after the sensor lost it, e.g.
+ *  in a brownout. Only registers that differ from their power-on values are
+ *  written, the thresholds in one transaction, and MAIN_CTRL goes last so the
+ *  first conversion already uses the restored settings. Every MAIN_STATUS
+ *  read in the driver calls this by itself when it sees a power-on event
+ *  @returns True if every write succeeded
+ */
+bool Adafruit_LTR390::restoreConfig(void) {
+  LTR390_OP(LTR390_OP_RESTORE_CONFIG);
+  // the shadows are updated by the writes, so restore from a copy
+  const uint8_t regs[] = {LTR390_MEAS_RATE, LTR390_GAIN, LTR390_INT_CFG,
+                          LTR390_INT_PST};
+  const uint8_t values[] = {_measRate, _gainReg, _intCfg, _intPst};
+  const uint8_t defaults[] = {0x22, 0x01, 0x10, 0x00};
+  uint8_t thresholds[6];
+  memcpy(thresholds, _thresholds, sizeof(thresholds));
+  uint8_t ctrl = _mainCtrl;
+
+  for (uint8_t i = 0; i < sizeof(regs); i++) {
+    if ((values[i] != defaults[i]) && !writeRegister(regs[i], &values[i], 1)) {
+      return false;
+    }
+  }
+
+  // one write covering the first to the last changed threshold byte
+  int8_t first = -1, last = -1;
+  for (int8_t i = 0; i < 6; i++) {
+    if (thresholds[i] != default_thresholds[i]) {
+      if (first < 0) {
+        first = i;
+      }
+      last = i;
+    }
+  }
+  if ((first >= 0) && !writeRegister(LTR390_THRESH_UP + first,
+                                     thresholds + first, last - first + 1)) {
+    return false;
+  }
+
+  if (ctrl && !writeRegister(LTR390_MAIN_CTRL, &ctrl, 1)) {
     return false;
   }
 
+  _restorePending = false;
+  _configChanged = LTR390_STALE_READINGS;
   return true;
 }
 
 /*!
- *  @brief  Checks if new data is available in data register
+ *  @brief  Get the number of power-on events (brownouts) seen in MAIN_STATUS
+ *  since begin()
+ *  @returns How many times the sensor lost its configuration
+ */
+uint32_t Adafruit_LTR390::powerOnCount(void) { return _powerOns; }
+
+/*!
+ *  @brief  Replace the time source used for every delay and timestamp in the
+ *  driver, e.g. with a simulator's virtual clock so host runs don't sleep
+ *  @param  clock The new time source, copied, or NULL for millis()/micros()/
+ *  delay() (std::chrono on a host)
+ */
+void Adafruit_LTR390::setClock(const ltr390_clock_t *clock) {
+  _clock = clock ? *clock : default_clock;
+}
+
+/*!
+ *  @brief  Get the driver's time in milliseconds
+ *  @returns Milliseconds from the driver's time source
+ */
+uint32_t Adafruit_LTR390::clockMillis(void) {
+  return _clock.millis(_clock.context);
+}
+
+/*!
+ *  @brief  Get the driver's time in microseconds
+ *  @returns Microseconds from the driver's time source, wraps every ~71
+ *  minutes
+ */
+uint32_t Adafruit_LTR390::clockMicros(void) {
+  return _clock.micros(_clock.context);
+}
+
+/*!
+ *  @brief  Wait using the driver's time source
+ *  @param  ms Milliseconds to wait
+ */
+void Adafruit_LTR390::clockDelay(uint32_t ms) {
+  _clock.delay(_clock.context, ms);
+}
+
+/*!
+ *  @brief  Checks if new data is available in data register. Also true if an
+ *  earlier status read saw new data that nobody has taken yet
  *  @returns True on new data available
  */
-bool Adafruit_LTR390::newDataAvailable(void) { return DataReadyBit->read(); }
+bool Adafruit_LTR390::newDataAvailable(void) {
+  LTR390_OP(LTR390_OP_NEW_DATA);
+  uint8_t status;
+  if (!statusRead(&status, 1)) {
+    _lastStatus = LTR390_BUS_ERROR;
+    return false;
+  }
+  bool ready = takeDataReady();
+  _lastStatus = ready ? LTR390_OK : LTR390_NO_DATA;
+  return ready;
+}
+
+/*!
+ *  @brief  Read MAIN_STATUS once. MAIN_STATUS clears when read, so its flags
+ *  are kept by the driver until taken with takeDataReady(), takeInterrupt()
+ *  or takePowerOn(). Every status read in the driver does this, so one bus
+ *  read serves all of them
+ *  @returns The flags read now plus those not yet taken: LTR390_STATUS_DATA,
+ *  LTR390_STATUS_INT and LTR390_STATUS_POWER_ON. Not updated if the read
+ *  failed, check lastStatus()
+ */
+uint8_t Adafruit_LTR390::readStatus(void) {
+  LTR390_OP(LTR390_OP_READ_STATUS);
+  uint8_t status;
+  if (!statusRead(&status, 1)) {
+    _lastStatus = LTR390_BUS_ERROR;
+  } else {
+    _lastStatus = LTR390_OK;
+  }
+  return _status;
+}
+
+/*!
+ *  @brief  Get the status flags read but not yet taken, without bus traffic
+ *  @returns LTR390_STATUS_DATA, LTR390_STATUS_INT and LTR390_STATUS_POWER_ON
+ */
+uint8_t Adafruit_LTR390::latchedStatus(void) {
+  LTR390_OP(LTR390_OP_TAKE_STATUS);
+  return _status;
+}
+
+/*!
+ *  @brief  Take the new data flag from the last status reads, without bus
+ *  traffic
+ *  @returns True if a status read saw new data since the flag was last taken
+ */
+bool Adafruit_LTR390::takeDataReady(void) {
+  LTR390_OP(LTR390_OP_TAKE_STATUS);
+  bool ready = _status & LTR390_STATUS_DATA;
+  _status &= ~LTR390_STATUS_DATA;
+  return ready;
+}
+
+/*!
+ *  @brief  Take the interrupt flag from the last status reads, without bus
+ *  traffic
+ *  @returns True if a status read saw the threshold interrupt since the flag
+ *  was last taken
+ */
+bool Adafruit_LTR390::takeInterrupt(void) {
+  LTR390_OP(LTR390_OP_TAKE_STATUS);
+  bool triggered = _status & LTR390_STATUS_INT;
+  _status &= ~LTR390_STATUS_INT;
+  return triggered;
+}
+
+/*!
+ *  @brief  Take the power-on flag from the last status reads, without bus
+ *  traffic. The driver has already restored the configuration by then
+ *  @returns True if the sensor lost power since the flag was last taken
+ */
+bool Adafruit_LTR390::takePowerOn(void) {
+  LTR390_OP(LTR390_OP_TAKE_STATUS);
+  bool powered = _status & LTR390_STATUS_POWER_ON;
+  _status &= ~LTR390_STATUS_POWER_ON;
+  return powered;
+}
 
 /*!
  *  @brief  Read 3-bytes out of ambient data register, does not check if data is
  * new!
- *  @returns Up to 20 bits, right shifted into a 32 bit int
+ *  @returns Up to 20 bits, right shifted into a 32 bit int, less the dark
+ *  offset for the current gain and resolution
  */
 uint32_t Adafruit_LTR390::readALS(void) {
-  Adafruit_I2CRegister datareg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_ALSDATA, 3, LSBFIRST);
-  return datareg.read();
+  LTR390_OP(LTR390_OP_READ_ALS);
+  ltr390_sample_t sample;
+  if (!readSample(LTR390_ALSDATA, &sample)) {
+    return 0;
+  }
+  return sample.counts;
 }
 
 /*!
  *  @brief  Read 3-bytes out of UV data register, does not check if data is new!
- *  @returns Up to 20 bits, right shifted into a 32 bit int
+ *  @returns Up to 20 bits, right shifted into a 32 bit int, less the dark
+ *  offset for the current gain and resolution
  */
 uint32_t Adafruit_LTR390::readUVS(void) {
-  Adafruit_I2CRegister datareg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_UVSDATA, 3, LSBFIRST);
-  return datareg.read();
+  LTR390_OP(LTR390_OP_READ_UVS);
+  ltr390_sample_t sample;
+  if (!readSample(LTR390_UVSDATA, &sample)) {
+    return 0;
+  }
+  return sample.counts;
+}
+
+/*!
+ *  @brief  Read 3-bytes out of ambient data register and flag the reading,
+ *  does not check if data is new!
+ *  @param  sample Where to put the reading and its flags
+ *  @returns True if the bus read succeeded
+ */
+bool Adafruit_LTR390::readALS(ltr390_sample_t *sample) {
+  LTR390_OP(LTR390_OP_READ_ALS);
+  return readSample(LTR390_ALSDATA, sample);
+}
+
+/*!
+ *  @brief  Read 3-bytes out of UV data register and flag the reading,
+ *  does not check if data is new!
+ *  @param  sample Where to put the reading and its flags
+ *  @returns True if the bus read succeeded
+ */
+bool Adafruit_LTR390::readUVS(ltr390_sample_t *sample) {
+  LTR390_OP(LTR390_OP_READ_UVS);
+  return readSample(LTR390_UVSDATA, sample);
+}
+
+/*!
+ *  @brief  Serve repeated readALS()/readUVS() calls from memory while the
+ *  sensor can't have finished a new conversion. Needs the conversion phase,
+ *  which the driver learns from newDataAvailable(), readStatus(),
+ *  readNewData() or poll() seeing new data. Until then, and for a few
+ *  periods after the last such call, every read goes to the bus
+ *  @param  enable True to turn the cache on
+ */
+void Adafruit_LTR390::setReadCache(bool enable) {
+  _readCache = enable;
+  dropCache();
+}
+
+/*!
+ *  @brief  Get the number of reads the cache served without bus traffic
+ *  @returns Cache hits since the driver was made
+ */
+uint32_t Adafruit_LTR390::cacheHits(void) { return _cacheHits; }
+
+/*!
+ *  @brief  Set the level at or below which readings are flagged with
+ *  LTR390_SAMPLE_UNDERFLOW. Default is 0
+ *  @param  counts The noise floor, in raw counts
+ */
+void Adafruit_LTR390::setUnderflowThreshold(uint32_t counts) {
+  _underflow = counts;
+}
+
+/*!
+ *  @brief  Measure the dark offset at one gain and resolution. Cover the
+ *  sensor first! Leaves the sensor at the given gain and resolution
+ *  @param  gain The gain to calibrate
+ *  @param  res The resolution to calibrate
+ *  @param  samples How many readings to average
+ *  @returns True on success, false if the sensor stopped producing data
+ */
+bool Adafruit_LTR390::calibrateDark(ltr390_gain_t gain,
+                                    ltr390_resolution_t res,
+                                    uint8_t samples) {
+  LTR390_OP(LTR390_OP_CALIBRATE_DARK);
+  setGain(gain);
+  setResolution(res);
+  _darkOffsets[gain][res] = 0;
+  _darkOffset = 0;
+
+  uint32_t sum = 0;
+  uint8_t taken = 0;
+  uint32_t start = clockMillis();
+
+  while (taken < samples) {
+    // slowest measurement period is 2 seconds
+    if (clockMillis() - start > (uint32_t)(samples + 2) * 2000) {
+      updateDarkOffset();
+      return false;
+    }
+    if (!newDataAvailable()) {
+      busDelay(5);
+      continue;
+    }
+    ltr390_sample_t sample;
+    if (!readSample((_mode == LTR390_MODE_UVS) ? LTR390_UVSDATA
+                                               : LTR390_ALSDATA,
+                    &sample)) {
+      continue;
+    }
+    // the reading that was waiting, and the one converting when the
+    // settings changed, may have been measured at the old settings
+    if (sample.flags & LTR390_SAMPLE_CONFIG_CHANGED) {
+      continue;
+    }
+    sum += sample.counts;
+    taken++;
+  }
+
+  uint32_t offset = (samples > 0) ? (sum + samples / 2) / samples : 0;
+  _darkOffsets[gain][res] = (offset > 0xFFFF) ? 0xFFFF : offset;
+  updateDarkOffset();
+  return true;
+}
+
+/*!
+ *  @brief  Set the dark offset for one gain and resolution
+ *  @param  gain The gain
+ *  @param  res The resolution
+ *  @param  counts Counts to subtract from readings taken at this setting
+ */
+void Adafruit_LTR390::setDarkOffset(ltr390_gain_t gain,
+                                    ltr390_resolution_t res,
+                                    uint16_t counts) {
+  _darkOffsets[gain][res] = counts;
+  updateDarkOffset();
+}
+
+/*!
+ *  @brief  Get the dark offset for one gain and resolution
+ *  @param  gain The gain
+ *  @param  res The resolution
+ *  @returns Counts subtracted from readings taken at this setting
+ */
+uint16_t Adafruit_LTR390::getDarkOffset(ltr390_gain_t gain,
+                                        ltr390_resolution_t res) {
+  return _darkOffsets[gain][res];
+}
+
+/*!
+ *  @brief  Save the dark offset table, e.g. to EEPROM
+ *  @param  buffer Where to write the table, little endian
+ *  @param  len Size of buffer, at least LTR390_DARK_TABLE_SIZE
+ *  @returns Number of bytes written, 0 if the buffer is too small
+ */
+size_t Adafruit_LTR390::saveDarkOffsets(uint8_t *buffer, size_t len) {
+  if (len < LTR390_DARK_TABLE_SIZE) {
+    return 0;
+  }
+  uint8_t *p = buffer;
+  for (uint8_t g = 0; g < 5; g++) {
+    for (uint8_t r = 0; r < 6; r++) {
+      *p++ = _darkOffsets[g][r] & 0xFF;
+      *p++ = _darkOffsets[g][r] >> 8;
+    }
+  }
+  return LTR390_DARK_TABLE_SIZE;
+}
+
+/*!
+ *  @brief  Load a dark offset table written by saveDarkOffsets()
+ *  @param  buffer The saved table
+ *  @param  len Size of buffer, at least LTR390_DARK_TABLE_SIZE
+ *  @returns True on success, false if the buffer is too small
+ */
+bool Adafruit_LTR390::loadDarkOffsets(const uint8_t *buffer, size_t len) {
+  if (len < LTR390_DARK_TABLE_SIZE) {
+    return false;
+  }
+  const uint8_t *p = buffer;
+  for (uint8_t g = 0; g < 5; g++) {
+    for (uint8_t r = 0; r < 6; r++) {
+      _darkOffsets[g][r] = p[0] | ((uint16_t)p[1] << 8);
+      p += 2;
+    }
+  }
+  updateDarkOffset();
+  return true;
+}
+
+/*!
+ *  @brief  Look up the dark offset for the current gain and resolution once,
+ *  so the read path only has to subtract it
+ */
+void Adafruit_LTR390::updateDarkOffset(void) {
+  _darkOffset = _darkOffsets[_gain][_resolution];
+}
+
+/*!
+ *  @brief  Read the status and, if it is there, the new reading for the
+ *  current mode in a single bus transaction (MAIN_STATUS through the end of
+ *  the data register, 9 bytes for ALS or 12 for UVS)
+ *  @param  sample Where to put the reading and its flags
+ *  @returns True if a new reading was available and has been read
+ */
+bool Adafruit_LTR390::readNewData(ltr390_sample_t *sample) {
+  LTR390_OP(LTR390_OP_READ_NEW_DATA);
+  _lastStatus = burstRead(sample);
+  return _lastStatus == LTR390_OK;
+}
+
+/*!
+ *  @brief  Non-blocking read with retries. Checks for a new reading like
+ *  readNewData(), but a failed transaction is retried on a later call after
+ *  a bounded exponential backoff instead of losing the reading. Call this
+ *  from loop() as often as you like, it never waits
+ *  @param  sample Where to put the reading and its flags
+ *  @returns LTR390_OK with a new reading in sample, LTR390_NO_DATA,
+ *  LTR390_RETRY_WAIT while backing off, or LTR390_BUS_ERROR once the
+ *  retries run out
+ */
+ltr390_status_t Adafruit_LTR390::poll(ltr390_sample_t *sample) {
+  LTR390_OP(LTR390_OP_POLL);
+  uint32_t now = clockMillis();
+
+  if (_retryAttempt > 0) {
+    if ((int32_t)(now - _retryAt) < 0) {
+      return LTR390_RETRY_WAIT;
+    }
+    _retryStats.retries++;
+  }
+
+  ltr390_status_t status = burstRead(sample);
+  _lastStatus = status;
+
+  if (status != LTR390_BUS_ERROR) {
+    if (_retryAttempt > 0) {
+      _retryStats.recovered++;
+      _retryAttempt = 0;
+    }
+    return status;
+  }
+
+  _retryStats.errors++;
+  if (_retryAttempt >= _retryPolicy.maxRetries) {
+    _retryStats.exhausted++;
+    _retryAttempt = 0;
+    return LTR390_BUS_ERROR;
+  }
+
+  // double per retry, stopping at the cap rather than shifting past 32 bits
+  uint32_t backoff = _retryPolicy.baseDelayMs;
+  for (uint8_t i = 0;
+       (i < _retryAttempt) && (backoff < _retryPolicy.maxDelayMs); i++) {
+    backoff *= 2;
+  }
+  if (backoff > _retryPolicy.maxDelayMs) {
+    backoff = _retryPolicy.maxDelayMs;
+  }
+  _retryAttempt++;
+  _retryAt = now + backoff;
+  return LTR390_RETRY_WAIT;
+}
+
+/*!
+ *  @brief  Set how failed transactions are retried by poll() and begin().
+ *  poll() never waits, it returns LTR390_RETRY_WAIT until the backoff is
+ *  over. begin() has nothing to return to, so it sleeps through each
+ *  backoff, up to maxRetries * maxDelayMs in all
+ *  @param  policy Number of retries, and first and longest backoff in ms.
+ *  The backoff doubles after each failed retry. maxRetries is capped at
+ *  LTR390_MAX_RETRIES, and maxDelayMs raised to baseDelayMs if it is less
+ */
+void Adafruit_LTR390::setRetryPolicy(const ltr390_retry_policy_t *policy) {
+  _retryPolicy = *policy;
+  if (_retryPolicy.maxRetries > LTR390_MAX_RETRIES) {
+    _retryPolicy.maxRetries = LTR390_MAX_RETRIES;
+  }
+  if (_retryPolicy.maxDelayMs < _retryPolicy.baseDelayMs) {
+    _retryPolicy.maxDelayMs = _retryPolicy.baseDelayMs;
+  }
+}
+
+/*!
+ *  @brief  Get the retry counters
+ *  @param  stats Where to put the counters
+ */
+void Adafruit_LTR390::getRetryStats(ltr390_retry_stats_t *stats) {
+  *stats = _retryStats;
+}
+
+/*!
+ *  @brief  Zero the retry counters
+ */
+void Adafruit_LTR390::resetRetryStats(void) {
+  memset(&_retryStats, 0, sizeof(_retryStats));
+}
+
+/*!
+ *  @brief  Get the outcome of the last newDataAvailable(), readALS(),
+ *  readUVS(), readNewData() or poll()
+ *  @returns LTR390_OK, LTR390_NO_DATA (status only), LTR390_RETRY_WAIT
+ *  (poll() only) or LTR390_BUS_ERROR
+ */
+ltr390_status_t Adafruit_LTR390::lastStatus(void) { return _lastStatus; }
+
+/*!
+ *  @brief  Read MAIN_STATUS through the current data register in one
+ *  transaction
+ *  @param  sample Where to put the reading if there is a new one
+ *  @returns LTR390_OK, LTR390_NO_DATA or LTR390_BUS_ERROR
+ */
+ltr390_status_t Adafruit_LTR390::burstRead(ltr390_sample_t *sample) {
+  uint8_t buffer[LTR390_UVSDATA + 3 - LTR390_MAIN_STATUS];
+  uint8_t data = (_mode == LTR390_MODE_UVS) ? LTR390_UVSDATA : LTR390_ALSDATA;
+  size_t len = data + 3 - LTR390_MAIN_STATUS;
+
+  if (!statusRead(buffer, len)) {
+    return LTR390_BUS_ERROR;
+  }
+  if (!takeDataReady()) {
+    return LTR390_NO_DATA;
+  }
+  if (_readCache) {
+    memcpy(_cacheData, buffer + (data - LTR390_MAIN_STATUS), 3);
+    _cacheAt = _statusAt;
+    _cacheValid = true;
+  }
+  decodeSample(buffer + (data - LTR390_MAIN_STATUS), sample);
+  publish(data, sample, clockMicros());
+  return LTR390_OK;
+}
+
+/*!
+ *  @brief  Read MAIN_STATUS, and any registers after it, and latch the status
+ *  @param  buffer Where to put the registers, MAIN_STATUS first
+ *  @param  len How many registers to read
+ *  @returns False if the read, or a configuration restore, failed
+ */
+bool Adafruit_LTR390::statusRead(uint8_t *buffer, size_t len) {
+  uint32_t start = _readCache ? clockMicros() : 0;
+  if (!readRegister(LTR390_MAIN_STATUS, buffer, len)) {
+    return false;
+  }
+  if (_readCache) {
+    _statusAt = start;
+    updatePhase(buffer[0], start, clockMicros());
+  }
+  return latchStatus(buffer[0]);
+}
+
+/*!
+ *  @brief  Narrow down when the last conversion ended, for the read cache.
+ *  The data flag clears when read, so a read that sees it set means a
+ *  conversion ended since the last read that saw it clear
+ *  @param  status MAIN_STATUS as just read
+ *  @param  start clockMicros() before the read
+ *  @param  end clockMicros() after the read
+ */
+void Adafruit_LTR390::updatePhase(uint8_t status, uint32_t start,
+                                  uint32_t end) {
+  if (status & LTR390_STATUS_POWER_ON) {
+    dropCache();
+  }
+  if (!(status & LTR390_STATUS_DATA)) {
+    _noDataAt = start;
+    _noDataValid = true;
+    return;
+  }
+  if (_phaseSkip > 0) {
+    _phaseSkip--;
+    _noDataValid = false;
+    return;
+  }
+  // conversions are back to back, so the last one ended within a period
+  uint32_t period = periodMicros(_resolution, (ltr390_rate_t)(_measRate & 7));
+  uint32_t low = end - (period + period / LTR390_PERIOD_TOLERANCE);
+  if (_noDataValid && ((int32_t)(_noDataAt - low) > 0)) {
+    low = _noDataAt;
+  }
+  _phaseLow = low;
+  _phaseHigh = end;
+  _phaseValid = true;
+  _noDataValid = false;
+}
+
+/*!
+ *  @brief  Check no conversion can have ended between the cached read and
+ *  now. Conversion k after the one in the phase window ends no later than
+ *  _phaseHigh + k * longest period and no earlier than _phaseLow +
+ *  k * shortest period
+ *  @param  now clockMicros()
+ *  @returns True if _cacheData is still the latest reading
+ */
+bool Adafruit_LTR390::cacheFresh(uint32_t now) {
+  if (!_cacheValid || !_phaseValid ||
+      ((int32_t)(_cacheAt - _phaseHigh) < 0) ||
+      ((int32_t)(now - _phaseLow) < 0)) {
+    return false;
+  }
+  uint32_t period = periodMicros(_resolution, (ltr390_rate_t)(_measRate & 7));
+  uint32_t shortest = period - period / LTR390_PERIOD_TOLERANCE;
+  uint32_t longest = period + period / LTR390_PERIOD_TOLERANCE;
+
+  // the last conversion known to have ended before the cached read
+  uint32_t k = (_cacheAt - _phaseHigh) / longest;
+  if (k >= LTR390_PERIOD_TOLERANCE) {
+    return false; // too far from the phase window, the error adds up
+  }
+  return (k + 1) * shortest > now - _phaseLow;
+}
+
+/*!
+ *  @brief  Forget the cached reading and the conversion phase, after the
+ *  configuration changed. The next new data flag may have been set before
+ *  the change, and the conversion running during it has odd timing, so the
+ *  phase is learned again from the one after those
+ */
+void Adafruit_LTR390::dropCache(void) {
+  _cacheValid = false;
+  _phaseValid = false;
+  _noDataValid = false;
+  _phaseSkip = 2;
+}
+
+/*!
+ *  @brief  Keep the flags of a MAIN_STATUS read until they are taken, and
+ *  restore the configuration if the sensor reports a power-on event. A
+ *  restore that fails is tried again on the next status read, as the flag
+ *  itself is gone once read
+ *  @param  status MAIN_STATUS as just read
+ *  @returns False if a restore was needed and failed
+ */
+bool Adafruit_LTR390::latchStatus(uint8_t status) {
+  if (status & LTR390_STATUS_POWER_ON) {
+    _status &= ~LTR390_STATUS_DATA; // the data registers were reset too
+    _powerOns++;
+    _restorePending = true;
+  }
+  _status |= status & (LTR390_STATUS_DATA | LTR390_STATUS_INT |
+                       LTR390_STATUS_POWER_ON);
+  return !_restorePending || restoreConfig();
+}
+
+/*!
+ *  @brief  Get the conversion time for a resolution
+ *  @param  res The resolution
+ *  @returns Conversion time in microseconds
+ */
+uint32_t Adafruit_LTR390::conversionMicros(ltr390_resolution_t res) {
+  static const uint32_t times[] = {400000, 200000, 100000,
+                                   50000,  25000,  12500};
+  return times[(res > LTR390_RESOLUTION_13BIT) ? LTR390_RESOLUTION_13BIT
+                                               : res];
+}
+
+/*!
+ *  @brief  Get the measurement period for a rate setting
+ *  @param  rate The rate
+ *  @returns Period in microseconds
+ */
+uint32_t Adafruit_LTR390::rateMicros(ltr390_rate_t rate) {
+  static const uint32_t times[] = {25000,  50000,   100000, 200000,
+                                   500000, 1000000, 2000000};
+  return times[(rate > LTR390_RATE_2000MS) ? LTR390_RATE_2000MS : rate];
+}
+
+/*!
+ *  @brief  Get the time between data register updates. The sensor can't
+ *  start conversions faster than it finishes them, so this is the longer of
+ *  the conversion time and the measurement rate
+ *  @param  res The resolution
+ *  @param  rate The measurement rate
+ *  @returns Period in microseconds
+ */
+uint32_t Adafruit_LTR390::periodMicros(ltr390_resolution_t res,
+                                       ltr390_rate_t rate) {
+  uint32_t conv = conversionMicros(res);
+  uint32_t period = rateMicros(rate);
+  return (period > conv) ? period : conv;
+}
+
+/*!
+ *  @brief  Read one data register and tag the reading with its flags
+ *  @param  reg LTR390_ALSDATA or LTR390_UVSDATA
+ *  @param  sample Where to put the reading and its flags
+ *  @returns True if the bus read succeeded
+ */
+bool Adafruit_LTR390::readSample(uint8_t reg, ltr390_sample_t *sample) {
+  uint8_t buffer[3];
+  bool cacheable =
+      _readCache &&
+      (reg == ((_mode == LTR390_MODE_UVS) ? LTR390_UVSDATA : LTR390_ALSDATA));
+  uint32_t start = 0;
+
+  if (cacheable) {
+    start = clockMicros();
+    if (cacheFresh(start)) {
+      _cacheHits++;
+      _lastStatus = LTR390_OK;
+      decodeSample(_cacheData, sample);
+      return true;
+    }
+  }
+
+  if (!readRegister(reg, buffer, 3)) {
+    _lastStatus = LTR390_BUS_ERROR;
+    return false;
+  }
+
+  if (cacheable) {
+    memcpy(_cacheData, buffer, 3);
+    _cacheAt = start;
+    _cacheValid = true;
+  }
+
+  _lastStatus = LTR390_OK;
+  decodeSample(buffer, sample);
+  publish(reg, sample, clockMicros());
+  return true;
+}
+
+// Snapshot fields are written by one context while others copy them, so
+// each access is atomic: a release store can't move before the odd sequence
+// store, and an acquire load can't move after the sequence check. AVR has
+// one core and no multi-byte atomics, volatile is enough against interrupts
+template <typename T> static inline T snapLoad(const T *field) {
+#if defined(__AVR__)
+  return *(const volatile T *)field;
+#else
+  return __atomic_load_n(field, __ATOMIC_ACQUIRE);
+#endif
+}
+
+template <typename T> static inline void snapStore(T *field, T value) {
+#if defined(__AVR__)
+  *(volatile T *)field = value;
+#else
+  __atomic_store_n(field, value, __ATOMIC_RELEASE);
+#endif
+}
+
+static void snapCopy(ltr390_reading_t *to, const ltr390_reading_t *from) {
+  to->valid = snapLoad(&from->valid);
+  to->counts = snapLoad(&from->counts);
+  to->flags = snapLoad(&from->flags);
+  to->micros = snapLoad(&from->micros);
+  to->gain = snapLoad(&from->gain);
+  to->resolution = snapLoad(&from->resolution);
+}
+
+/*!
+ *  @brief  Make a reading visible to getSnapshot(). Only the context that
+ *  reads the sensor may call this. The sequence is odd while the snapshot
+ *  is inconsistent, and the release stores keep the field writes between
+ *  the two sequence updates
+ *  @param  reg LTR390_ALSDATA or LTR390_UVSDATA
+ *  @param  sample The reading
+ *  @param  micros clockMicros() of the reading
+ */
+void Adafruit_LTR390::publish(uint8_t reg, const ltr390_sample_t *sample,
+                              uint32_t micros) {
+  ltr390_reading_t *reading =
+      (reg == LTR390_UVSDATA) ? &_snapshot.uvs : &_snapshot.als;
+  ltr390_seq_t seq = __atomic_load_n(&_snapSeq, __ATOMIC_RELAXED);
+
+  __atomic_store_n(&_snapSeq, (ltr390_seq_t)(seq + 1), __ATOMIC_RELAXED);
+  snapStore(&reading->valid, true);
+  snapStore(&reading->counts, sample->counts);
+  snapStore(&reading->flags, sample->flags);
+  snapStore(&reading->micros, micros);
+  snapStore(&reading->gain, _gain);
+  snapStore(&reading->resolution, _resolution);
+  snapStore(&_snapshot.sequence, _snapshot.sequence + 1);
+  __atomic_store_n(&_snapSeq, (ltr390_seq_t)(seq + 2), __ATOMIC_RELEASE);
+}
+
+/*!
+ *  @brief  Get the latest ALS and UVS readings without locks or bus
+ *  traffic, from any thread, task or core, while another one reads the
+ *  sensor. A copy that overlapped a new reading is thrown away and taken
+ *  again, up to LTR390_SNAPSHOT_TRIES times, so a torn copy is never
+ *  returned. A channel not read yet comes back with valid false
+ *  @param  snapshot Where to put the readings, its contents are undefined
+ *  after a false return
+ *  @returns True with a consistent copy. False if every try overlapped a
+ *  new reading, because readings kept arriving mid-copy or the caller
+ *  preempted the sensor's task mid-write, try again later
+ */
+bool Adafruit_LTR390::getSnapshot(ltr390_snapshot_t *snapshot) {
+  for (uint8_t tries = 0; tries < LTR390_SNAPSHOT_TRIES; tries++) {
+    ltr390_seq_t before = __atomic_load_n(&_snapSeq, __ATOMIC_ACQUIRE);
+    if (before & 1) {
+      continue;
+    }
+    snapCopy(&snapshot->als, &_snapshot.als);
+    snapCopy(&snapshot->uvs, &_snapshot.uvs);
+    snapshot->sequence = snapLoad(&_snapshot.sequence);
+    if (__atomic_load_n(&_snapSeq, __ATOMIC_RELAXED) == before) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ *  @brief  Turn 3 raw data register bytes into a flagged, dark corrected
+ *  reading
+ *  @param  buffer The data register bytes, LSB first
+ *  @param  sample Where to put the reading and its flags
+ */
+void Adafruit_LTR390::decodeSample(const uint8_t *buffer,
+                                   ltr390_sample_t *sample) {
+  sample->counts = ((uint32_t)(buffer[2] & 0x0F) << 16) |
+                   ((uint32_t)buffer[1] << 8) | buffer[0];
+  sample->flags = 0;
+  if (sample->counts >= fullScale(_resolution)) {
+    sample->flags |= LTR390_SAMPLE_SATURATED;
+  }
+  sample->counts =
+      (sample->counts > _darkOffset) ? sample->counts - _darkOffset : 0;
+  if (sample->counts <= _underflow) {
+    sample->flags |= LTR390_SAMPLE_UNDERFLOW;
+  }
+  if (_configChanged) {
+    sample->flags |= LTR390_SAMPLE_CONFIG_CHANGED;
+    _configChanged--;
+  }
 }
 
 /*!
@@ -132,12 +1117,8 @@ uint32_t Adafruit_LTR390::readUVS(void) {
  *  @param  en True to enable, False to disable
  */
 void Adafruit_LTR390::enable(bool en) {
-  Adafruit_I2CRegister mainreg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_MAIN_CTRL);
-  Adafruit_I2CRegisterBits enbit =
-      Adafruit_I2CRegisterBits(&mainreg, 1, 1); // # bits, bit_shift
-
-  enbit.write(en);
+  LTR390_OP(LTR390_OP_ENABLE);
+  writeBits(LTR390_MAIN_CTRL, 1, 1, en); // # bits, bit_shift
 }
 
 /*!
@@ -145,26 +1126,22 @@ void Adafruit_LTR390::enable(bool en) {
  *  @returns True if enabled
  */
 bool Adafruit_LTR390::enabled(void) {
-  Adafruit_I2CRegister mainreg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_MAIN_CTRL);
-  Adafruit_I2CRegisterBits enbit =
-      Adafruit_I2CRegisterBits(&mainreg, 1, 1); // # bits, bit_shift
-
-  return enbit.read();
+  LTR390_OP(LTR390_OP_ENABLED);
+  return readBits(LTR390_MAIN_CTRL, 1, 1);
 }
 
 /*!
  *  @brief  Set the sensor mode to EITHER ambient (LTR390_MODE_ALS) or UV
  * (LTR390_MODE_UVS)
  *  @param  mode The desired mode - LTR390_MODE_UVS or LTR390_MODE_ALS
+ *  @returns True if the bus write succeeded
  */
-void Adafruit_LTR390::setMode(ltr390_mode_t mode) {
-  Adafruit_I2CRegister mainreg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_MAIN_CTRL);
-  Adafruit_I2CRegisterBits modebit =
-      Adafruit_I2CRegisterBits(&mainreg, 1, 3); // # bits, bit_shift
-
-  modebit.write(mode);
+bool Adafruit_LTR390::setMode(ltr390_mode_t mode) {
+  LTR390_OP(LTR390_OP_SET_MODE);
+  bool ok = writeBits(LTR390_MAIN_CTRL, 1, 3, mode); // # bits, bit_shift
+  _mode = mode;
+  _configChanged = LTR390_STALE_READINGS;
+  return ok;
 }
 
 /*!
@@ -172,25 +1149,23 @@ void Adafruit_LTR390::setMode(ltr390_mode_t mode) {
  *  @returns The current mode - LTR390_MODE_UVS or LTR390_MODE_ALS
  */
 ltr390_mode_t Adafruit_LTR390::getMode(void) {
-  Adafruit_I2CRegister mainreg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_MAIN_CTRL);
-  Adafruit_I2CRegisterBits modebit =
-      Adafruit_I2CRegisterBits(&mainreg, 1, 3); // # bits, bit_shift
-
-  return (ltr390_mode_t)modebit.read();
+  LTR390_OP(LTR390_OP_GET_MODE);
+  return (ltr390_mode_t)readBits(LTR390_MAIN_CTRL, 1, 3);
 }
 
 /*!
  *  @brief  Set the sensor gain
  *  @param  gain The desired gain: LTR390_GAIN_1, LTR390_GAIN_3, LTR390_GAIN_6
  *  LTR390_GAIN_9 or LTR390_GAIN_18
+ *  @returns True if the bus write succeeded
  */
-void Adafruit_LTR390::setGain(ltr390_gain_t gain) {
-  Adafruit_I2CRegister gainreg = Adafruit_I2CRegister(i2c_dev, LTR390_GAIN);
-  Adafruit_I2CRegisterBits gainbits =
-      Adafruit_I2CRegisterBits(&gainreg, 3, 0); // # bits, bit_shift
-
-  gainbits.write(gain);
+bool Adafruit_LTR390::setGain(ltr390_gain_t gain) {
+  LTR390_OP(LTR390_OP_SET_GAIN);
+  bool ok = writeBits(LTR390_GAIN, 3, 0, gain); // # bits, bit_shift
+  _gain = gain;
+  _configChanged = LTR390_STALE_READINGS;
+  updateDarkOffset();
+  return ok;
 }
 
 /*!
@@ -199,11 +1174,8 @@ void Adafruit_LTR390::setGain(ltr390_gain_t gain) {
  *  LTR390_GAIN_9 or LTR390_GAIN_18
  */
 ltr390_gain_t Adafruit_LTR390::getGain(void) {
-  Adafruit_I2CRegister gainreg = Adafruit_I2CRegister(i2c_dev, LTR390_GAIN);
-  Adafruit_I2CRegisterBits gainbits =
-      Adafruit_I2CRegisterBits(&gainreg, 3, 0); // # bits, bit_shift
-
-  return (ltr390_gain_t)gainbits.read();
+  LTR390_OP(LTR390_OP_GET_GAIN);
+  return (ltr390_gain_t)readBits(LTR390_GAIN, 3, 0);
 }
 
 /*!
@@ -211,14 +1183,15 @@ ltr390_gain_t Adafruit_LTR390::getGain(void) {
  *  @param  res The desired resolution: LTR390_RESOLUTION_13BIT,
  *  LTR390_RESOLUTION_16BIT, LTR390_RESOLUTION_17BIT, LTR390_RESOLUTION_18BIT,
  *  LTR390_RESOLUTION_19BIT or LTR390_RESOLUTION_20BIT
+ *  @returns True if the bus write succeeded
  */
-void Adafruit_LTR390::setResolution(ltr390_resolution_t res) {
-  Adafruit_I2CRegister ratereg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_MEAS_RATE);
-  Adafruit_I2CRegisterBits resbits =
-      Adafruit_I2CRegisterBits(&ratereg, 3, 4); // # bits, bit_shift
-
-  resbits.write(res);
+bool Adafruit_LTR390::setResolution(ltr390_resolution_t res) {
+  LTR390_OP(LTR390_OP_SET_RESOLUTION);
+  bool ok = writeBits(LTR390_MEAS_RATE, 3, 4, res); // # bits, bit_shift
+  _resolution = res;
+  _configChanged = LTR390_STALE_READINGS;
+  updateDarkOffset();
+  return ok;
 }
 
 /*!
@@ -228,12 +1201,38 @@ void Adafruit_LTR390::setResolution(ltr390_resolution_t res) {
  *  LTR390_RESOLUTION_19BIT or LTR390_RESOLUTION_20BIT
  */
 ltr390_resolution_t Adafruit_LTR390::getResolution(void) {
-  Adafruit_I2CRegister ratereg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_MEAS_RATE);
-  Adafruit_I2CRegisterBits resbits =
-      Adafruit_I2CRegisterBits(&ratereg, 3, 4); // # bits, bit_shift
+  LTR390_OP(LTR390_OP_GET_RESOLUTION);
+  return (ltr390_resolution_t)readBits(LTR390_MEAS_RATE, 3, 4);
+}
+
+/*!
+ *  @brief  Set the sensor measurement rate. If the rate is faster than the
+ *  conversion time of the current resolution, the conversion time wins
+ *  @param  rate The desired rate: LTR390_RATE_25MS, LTR390_RATE_50MS,
+ *  LTR390_RATE_100MS, LTR390_RATE_200MS, LTR390_RATE_500MS,
+ *  LTR390_RATE_1000MS or LTR390_RATE_2000MS
+ *  @returns True if the bus write succeeded
+ */
+bool Adafruit_LTR390::setMeasurementRate(ltr390_rate_t rate) {
+  LTR390_OP(LTR390_OP_SET_RATE);
+  bool ok = writeBits(LTR390_MEAS_RATE, 3, 0, rate); // # bits, bit_shift
+  _configChanged = LTR390_STALE_READINGS;
+  return ok;
+}
 
-  return (ltr390_resolution_t)resbits.read();
+/*!
+ *  @brief  Get the sensor's measurement rate
+ *  @returns The current rate: LTR390_RATE_25MS, LTR390_RATE_50MS,
+ *  LTR390_RATE_100MS, LTR390_RATE_200MS, LTR390_RATE_500MS,
+ *  LTR390_RATE_1000MS or LTR390_RATE_2000MS
+ */
+ltr390_rate_t Adafruit_LTR390::getMeasurementRate(void) {
+  LTR390_OP(LTR390_OP_GET_RATE);
+  uint8_t rate = readBits(LTR390_MEAS_RATE, 3, 0);
+  if (rate > LTR390_RATE_2000MS) { // 110 and 111 are both 2000ms
+    rate = LTR390_RATE_2000MS;
+  }
+  return (ltr390_rate_t)rate;
 }
 
 /*!
@@ -243,13 +1242,18 @@ ltr390_resolution_t Adafruit_LTR390::getResolution(void) {
  *  @param  higher The higher value to compare against the data register.
  */
 void Adafruit_LTR390::setThresholds(uint32_t lower, uint32_t higher) {
-  Adafruit_I2CRegister lowreg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_THRESH_LOW, 3, LSBFIRST);
-  lowreg.write(lower);
+  LTR390_OP(LTR390_OP_SET_THRESHOLDS);
+  uint8_t buffer[3];
 
-  Adafruit_I2CRegister upreg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_THRESH_UP, 3, LSBFIRST);
-  upreg.write(higher);
+  buffer[0] = lower & 0xFF;
+  buffer[1] = (lower >> 8) & 0xFF;
+  buffer[2] = (lower >> 16) & 0x0F;
+  writeRegister(LTR390_THRESH_LOW, buffer, 3);
+
+  buffer[0] = higher & 0xFF;
+  buffer[1] = (higher >> 8) & 0xFF;
+  buffer[2] = (higher >> 16) & 0x0F;
+  writeRegister(LTR390_THRESH_UP, buffer, 3);
 }
 
 /*!
@@ -263,24 +1267,377 @@ void Adafruit_LTR390::setThresholds(uint32_t lower, uint32_t higher) {
  */
 void Adafruit_LTR390::configInterrupt(bool enable, ltr390_mode_t source,
                                       uint8_t persistance) {
-  Adafruit_I2CRegister intcfgreg =
-      Adafruit_I2CRegister(i2c_dev, LTR390_INT_CFG);
-  Adafruit_I2CRegisterBits enbit =
-      Adafruit_I2CRegisterBits(&intcfgreg, 1, 2); // # bits, bit_shift
-
-  enbit.write(enable);
+  LTR390_OP(LTR390_OP_CONFIG_INTERRUPT);
+  writeBits(LTR390_INT_CFG, 1, 2, enable); // # bits, bit_shift
 
-  Adafruit_I2CRegisterBits srcbits =
-      Adafruit_I2CRegisterBits(&intcfgreg, 2, 4); // # bits, bit_shift
   if (source == LTR390_MODE_ALS) {
-    srcbits.write(1);
+    writeBits(LTR390_INT_CFG, 2, 4, 1); // # bits, bit_shift
   }
   if (source == LTR390_MODE_UVS) {
-    srcbits.write(3);
+    writeBits(LTR390_INT_CFG, 2, 4, 3); // # bits, bit_shift
   }
 
-  Adafruit_I2CRegister persreg = Adafruit_I2CRegister(i2c_dev, LTR390_INT_PST);
-  Adafruit_I2CRegisterBits pstbits =
-      Adafruit_I2CRegisterBits(&persreg, 4, 4); // # bits, bit_shift
-  pstbits.write(persistance);
+  writeBits(LTR390_INT_PST, 4, 4, persistance); // # bits, bit_shift
+}
+
+/*!
+ *  @brief  Get the bus traffic caused by one API call since the last
+ *  resetBusStats(). Always zero unless LTR390_BUS_STATS is 1
+ *  @param  op The API call, or LTR390_OP_NONE for traffic outside any call
+ *  @param  stats Where to put the counters
+ */
+void Adafruit_LTR390::getBusStats(ltr390_op_t op, ltr390_bus_stats_t *stats) {
+#if LTR390_BUS_STATS
+  *stats = _busStats[(op < LTR390_OP_COUNT) ? op : LTR390_OP_NONE];
+#else
+  (void)op;
+  memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+/*!
+ *  @brief  Zero the bus traffic counters for every API call
+ */
+void Adafruit_LTR390::resetBusStats(void) {
+#if LTR390_BUS_STATS
+  memset(_busStats, 0, sizeof(_busStats));
+#endif
+}
+
+/*!
+ *  @brief  Get the histogram of bus transaction durations. All zero unless
+ *  LTR390_BUS_HISTOGRAM is 1
+ *  @param  histogram Where to put the histogram
+ */
+void Adafruit_LTR390::getBusHistogram(ltr390_histogram_t *histogram) {
+#if LTR390_BUS_HISTOGRAM
+  *histogram = _histogram;
+#else
+  memset(histogram, 0, sizeof(*histogram));
+#endif
+}
+
+/*!
+ *  @brief  Zero the bus transaction duration histogram
+ */
+void Adafruit_LTR390::resetBusHistogram(void) {
+#if LTR390_BUS_HISTOGRAM
+  memset(&_histogram, 0, sizeof(_histogram));
+#endif
+}
+
+/*!
+ *  @brief  Log every bus transaction from now on
+ *  @param  trace The recorder, or NULL to stop recording
+ */
+void Adafruit_LTR390::setTrace(Adafruit_LTR390_Trace *trace) {
+  _trace = trace;
+}
+
+/*!
+ *  @brief  Use a lock around every public API call, so calls from different
+ *  tasks or threads can share the driver and the bus. The lock is taken once
+ *  per call, so a read-modify-write or a status check plus restore can't be
+ *  split up. Calls nest, e.g. reset() inside begin(), so the lock must be
+ *  recursive: std::recursive_mutex or a FreeRTOS recursive mutex.
+ *
+ *  The exception is a call that waits: begin() between its retries, reset()
+ *  for the soft reset, and calibrateDark() while it polls for readings. The
+ *  lock is released for the wait so other calls aren't held up for up to
+ *  seconds, which means those three are not atomic. Another thread's call
+ *  can run during the wait and see the sensor mid-reset or change the
+ *  settings being calibrated, so keep other calls away while they run
+ *  @param  lock The hook, copied, or NULL for no locking
+ */
+void Adafruit_LTR390::setBusLock(const ltr390_bus_lock_t *lock) {
+  if (lock) {
+    _busLock = *lock;
+  } else {
+    _busLock.lock = NULL;
+    _busLock.unlock = NULL;
+    _busLock.context = NULL;
+  }
+}
+
+/*!
+ *  @brief  Get how long API calls held the bus lock. Per call type too in
+ *  getBusStats() when LTR390_BUS_STATS is 1
+ *  @param  stats Where to put the hold times
+ */
+void Adafruit_LTR390::getLockStats(ltr390_lock_stats_t *stats) {
+  *stats = _lockStats;
+}
+
+/*!
+ *  @brief  Zero the bus lock hold times
+ */
+void Adafruit_LTR390::resetLockStats(void) {
+  memset(&_lockStats, 0, sizeof(_lockStats));
+}
+
+/*!
+ *  @brief  Marks the start of a public API call and takes the bus lock.
+ *  Nested calls (e.g. reset() inside begin()) are charged to the outermost
+ *  call. _depth and _op are only touched with the lock held, so another
+ *  thread's call is never mistaken for a nested one
+ *  @param  ltr The driver
+ *  @param  op The API call
+ */
+Adafruit_LTR390::OpScope::OpScope(Adafruit_LTR390 *ltr, ltr390_op_t op)
+    : _ltr(ltr) {
+  if (_ltr->_busLock.lock) {
+    _ltr->_busLock.lock(_ltr->_busLock.context);
+  }
+  _outer = (_ltr->_depth++ == 0);
+  if (_outer) {
+    _ltr->_op = op;
+#if LTR390_BUS_STATS
+    _ltr->_busStats[op].calls++;
+#endif
+    if (_ltr->_busLock.lock) {
+      _ltr->_callHold = 0;
+      _ltr->_holdStart = _ltr->clockMicros();
+    }
+  }
+}
+
+/*!
+ *  @brief  Marks the end of a public API call and releases the bus lock
+ */
+Adafruit_LTR390::OpScope::~OpScope() {
+  if (_outer && _ltr->_busLock.lock) {
+    uint32_t held =
+        _ltr->_callHold + (_ltr->clockMicros() - _ltr->_holdStart);
+    _ltr->_lockStats.holds++;
+    _ltr->_lockStats.holdMicros += held;
+    _ltr->_lockStats.lastMicros = held;
+    if (held > _ltr->_lockStats.maxMicros) {
+      _ltr->_lockStats.maxMicros = held;
+    }
+#if LTR390_BUS_STATS
+    _ltr->_busStats[_ltr->_op].lockMicros += held;
+#endif
+  }
+  if (_outer) {
+    _ltr->_op = LTR390_OP_NONE;
+  }
+  _ltr->_depth--;
+  if (_ltr->_busLock.unlock) {
+    _ltr->_busLock.unlock(_ltr->_busLock.context);
+  }
+}
+
+/*!
+ *  @brief  Wait inside an API call without holding the bus lock. Other
+ *  threads' calls may run meanwhile, so the call's nesting is set aside
+ *  and put back once the lock is taken again
+ *  @param  ms Milliseconds to wait
+ */
+void Adafruit_LTR390::busDelay(uint32_t ms) {
+  uint8_t depth = _depth;
+  if (!_busLock.lock || (depth == 0)) {
+    clockDelay(ms);
+    return;
+  }
+
+  ltr390_op_t op = _op;
+  uint32_t held = _callHold + (clockMicros() - _holdStart);
+  _depth = 0;
+  _op = LTR390_OP_NONE;
+  for (uint8_t i = 0; i < depth; i++) {
+    _busLock.unlock(_busLock.context);
+  }
+
+  clockDelay(ms);
+
+  for (uint8_t i = 0; i < depth; i++) {
+    _busLock.lock(_busLock.context);
+  }
+  _depth = depth;
+  _op = op;
+  _callHold = held;
+  _holdStart = clockMicros();
+}
+
+/*!
+ *  @brief  Read one or more consecutive registers through the transport
+ *  @param  reg The first register
+ *  @param  buffer Where to put the data
+ *  @param  len How many bytes to read
+ *  @returns True if the bus read succeeded
+ */
+bool Adafruit_LTR390::readRegister(uint8_t reg, uint8_t *buffer, size_t len) {
+#if LTR390_TIMED_BUS
+  uint32_t start = clockMicros();
+  bool ok = _read(_context, reg, buffer, len);
+  busDone(clockMicros() - start, len, 1); // register address too
+#else
+  bool ok = _read(_context, reg, buffer, len);
+#endif
+  if (_trace) {
+    _trace->record(clockMicros(), reg, false, ok, buffer, len);
+  }
+  return ok;
+}
+
+/*!
+ *  @brief  Write one or more consecutive registers through the transport
+ *  @param  reg The first register
+ *  @param  buffer The data
+ *  @param  len How many bytes to write
+ *  @returns True if the bus write succeeded
+ */
+bool Adafruit_LTR390::writeRegister(uint8_t reg, const uint8_t *buffer,
+                                    size_t len) {
+#if LTR390_TIMED_BUS
+  uint32_t start = clockMicros();
+  bool ok = _write(_context, reg, buffer, len);
+  busDone(clockMicros() - start, 0, len + 1); // register address too
+#else
+  bool ok = _write(_context, reg, buffer, len);
+#endif
+  if (ok) {
+    shadowWrite(reg, buffer, len);
+  }
+  if (_trace) {
+    _trace->record(clockMicros(), reg, true, ok, buffer, len);
+  }
+  return ok;
+}
+
+/*!
+ *  @brief  Set the register shadows to the sensor's power-on values
+ */
+void Adafruit_LTR390::shadowDefaults(void) {
+  _mainCtrl = 0x00;
+  _measRate = 0x22;
+  _gainReg = 0x01;
+  _intCfg = 0x10;
+  _intPst = 0x00;
+  memcpy(_thresholds, default_thresholds, sizeof(_thresholds));
+}
+
+/*!
+ *  @brief  Remember what was written to the configuration registers, for
+ *  restoreConfig()
+ *  @param  reg The first register written
+ *  @param  buffer The data
+ *  @param  len How many bytes were written
+ */
+void Adafruit_LTR390::shadowWrite(uint8_t reg, const uint8_t *buffer,
+                                  size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    uint8_t r = reg + i;
+    if (r == LTR390_MAIN_CTRL) {
+      _mainCtrl = buffer[i] & ~0x10; // never restore the reset bit
+      dropCache();
+    } else if (r == LTR390_MEAS_RATE) {
+      _measRate = buffer[i];
+      dropCache();
+    } else if (r == LTR390_GAIN) {
+      _gainReg = buffer[i];
+      dropCache();
+    } else if (r == LTR390_INT_CFG) {
+      _intCfg = buffer[i];
+    } else if (r == LTR390_INT_PST) {
+      _intPst = buffer[i];
+    } else if ((r >= LTR390_THRESH_UP) && (r < LTR390_THRESH_LOW + 3)) {
+      _thresholds[r - LTR390_THRESH_UP] = buffer[i];
+    }
+  }
+}
+
+#if LTR390_TIMED_BUS
+/*!
+ *  @brief  Account for one finished bus transaction
+ *  @param  us How long the transaction took
+ *  @param  rd Bytes read
+ *  @param  wr Bytes written
+ */
+void Adafruit_LTR390::busDone(uint32_t us, size_t rd, size_t wr) {
+#if LTR390_BUS_STATS
+  _busStats[_op].transactions++;
+  _busStats[_op].bytesRead += rd;
+  _busStats[_op].bytesWritten += wr;
+  _busStats[_op].busMicros += us;
+#endif
+#if LTR390_BUS_HISTOGRAM
+  // bucket n holds 2^(n-1) <= us < 2^n, bucket 0 is under 1us. A shift
+  // loop, as __builtin_clz() works on int, which is 16 bits on AVR
+  uint8_t bucket = 0;
+  while ((bucket < LTR390_HISTOGRAM_BUCKETS - 1) && (us >> bucket)) {
+    bucket++;
+  }
+  _histogram.buckets[bucket]++;
+  if (us > _histogram.maxMicros) {
+    _histogram.maxMicros = us;
+  }
+#endif
+  (void)rd;
+  (void)wr;
+}
+#endif
+
+/*!
+ *  @brief  Read a bit field out of a register
+ *  @param  reg The register
+ *  @param  bits Width of the field
+ *  @param  shift Position of the field's lowest bit
+ *  @returns The field, or 0 if the bus read failed
+ */
+uint8_t Adafruit_LTR390::readBits(uint8_t reg, uint8_t bits, uint8_t shift) {
+  uint8_t value;
+  if (!readRegister(reg, &value, 1)) {
+    return 0;
+  }
+  return (value >> shift) & ((1 << bits) - 1);
+}
+
+/*!
+ *  @brief  Read-modify-write a bit field in a register
+ *  @param  reg The register
+ *  @param  bits Width of the field
+ *  @param  shift Position of the field's lowest bit
+ *  @param  data The new field value
+ *  @returns True if both bus transactions succeeded
+ */
+bool Adafruit_LTR390::writeBits(uint8_t reg, uint8_t bits, uint8_t shift,
+                                uint8_t data) {
+  uint8_t value;
+  if (!readRegister(reg, &value, 1)) {
+    return false;
+  }
+  uint8_t mask = ((1 << bits) - 1) << shift;
+  value = (value & ~mask) | ((data << shift) & mask);
+  return writeRegister(reg, &value, 1);
+}
+
+#if defined(ARDUINO)
+/*!
+ *  @brief  Transport read for the built-in Adafruit_I2CDevice backend
+ *  @param  context The Adafruit_I2CDevice
+ *  @param  reg The first register
+ *  @param  buffer Where to put the data
+ *  @param  len How many bytes to read
+ *  @returns True if the bus read succeeded
+ */
+bool Adafruit_LTR390::i2cRead(void *context, uint8_t reg, uint8_t *buffer,
+                              size_t len) {
+  Adafruit_I2CDevice *dev = (Adafruit_I2CDevice *)context;
+  return dev->write_then_read(&reg, 1, buffer, len);
+}
+
+/*!
+ *  @brief  Transport write for the built-in Adafruit_I2CDevice backend
+ *  @param  context The Adafruit_I2CDevice
+ *  @param  reg The first register
+ *  @param  buffer The data
+ *  @param  len How many bytes to write
+ *  @returns True if the bus write succeeded
+ */
+bool Adafruit_LTR390::i2cWrite(void *context, uint8_t reg,
+                               const uint8_t *buffer, size_t len) {
+  Adafruit_I2CDevice *dev = (Adafruit_I2CDevice *)context;
+  return dev->write(buffer, len, true, &reg, 1);
 }
+#endif
@@ -17,10 +17,46 @@
 #ifndef _ADAFRUIT_LTR390_H
 #define _ADAFRUIT_LTR390_H
 
+#if defined(ARDUINO)
 #include "Arduino.h"
 #include <Adafruit_I2CDevice.h>
 #include <Adafruit_I2CRegister.h>
 #include <Wire.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#endif
+
+// LTR390_BUS_STATS and LTR390_BUS_HISTOGRAM add members to Adafruit_LTR390,
+// so the library and every file that includes it must agree on them. Set
+// them for the whole build (-D, build_flags), not with a #define before the
+// include, or sketch and library disagree on the class layout. Each setting
+// needs its own symbol from Adafruit_LTR390.cpp, so a mismatch fails to link
+// with an undefined reference to ltr390_config_stats<n>_histogram<n>
+#ifndef LTR390_BUS_STATS
+#define LTR390_BUS_STATS 0 ///< Set to 1 to count bus traffic per API call
+#endif
+
+#ifndef LTR390_BUS_HISTOGRAM
+#define LTR390_BUS_HISTOGRAM 0 ///< Set to 1 to histogram bus latency
+#endif
+
+/*!    @brief  Name of the symbol for one setting of the flags  */
+#define LTR390_CONFIG_NAME(stats, histogram)                                   \
+  ltr390_config_stats##stats##_histogram##histogram
+/*!    @brief  Expands the flags before LTR390_CONFIG_NAME() pastes them  */
+#define LTR390_CONFIG_SYMBOL(stats, histogram)                                 \
+  LTR390_CONFIG_NAME(stats, histogram)
+
+/*!    @brief  Defined by Adafruit_LTR390.cpp for the flags it was built with */
+extern "C" const char LTR390_CONFIG_SYMBOL(LTR390_BUS_STATS,
+                                           LTR390_BUS_HISTOGRAM);
+/*!    @brief  Makes each file that includes this need the build's symbol  */
+static const char *const ltr390_config_check __attribute__((used)) =
+    &LTR390_CONFIG_SYMBOL(LTR390_BUS_STATS, LTR390_BUS_HISTOGRAM);
+
+#define LTR390_HISTOGRAM_BUCKETS 16 ///< log2 buckets, the last is >= 16ms
 
 #define LTR390_I2CADDR_DEFAULT 0x53 ///< I2C address
 #define LTR390_MAIN_CTRL 0x00       ///< Main control register
@@ -60,6 +96,173 @@ typedef enum {
   LTR390_RESOLUTION_13BIT,
 } ltr390_resolution_t;
 
+/*!    @brief Measurement rate, the time between the start of two readings.
+ *     The sensor can not go faster than the resolution's conversion time!  */
+typedef enum {
+  LTR390_RATE_25MS,
+  LTR390_RATE_50MS,
+  LTR390_RATE_100MS,
+  LTR390_RATE_200MS,
+  LTR390_RATE_500MS,
+  LTR390_RATE_1000MS,
+  LTR390_RATE_2000MS,
+} ltr390_rate_t;
+
+#define LTR390_STATUS_DATA 0x08     ///< MAIN_STATUS: new data is ready
+#define LTR390_STATUS_INT 0x10      ///< MAIN_STATUS: interrupt triggered
+#define LTR390_STATUS_POWER_ON 0x20 ///< MAIN_STATUS: sensor lost power
+
+#define LTR390_DARK_TABLE_SIZE 60 ///< Bytes needed by saveDarkOffsets()
+
+#define LTR390_SAMPLE_SATURATED 0x01      ///< Reading is at full scale
+#define LTR390_SAMPLE_UNDERFLOW 0x02      ///< Reading is at/below the floor
+#define LTR390_SAMPLE_CONFIG_CHANGED 0x04 ///< May predate a config change
+
+/*!
+ *  Readings flagged LTR390_SAMPLE_CONFIG_CHANGED after a mode, gain,
+ *  resolution or rate change, a reset or a configuration restore: the one
+ *  that was already waiting, and the one that was converting when the
+ *  settings changed. Counted per reading read, so the rule holds when each
+ *  read follows a data-ready status, as with readNewData() or poll()
+ */
+#define LTR390_STALE_READINGS 2
+
+/*!    @brief  One reading plus flags describing whether it can be trusted  */
+typedef struct {
+  uint32_t counts; ///< Up to 20 bits of raw data
+  uint8_t flags;   ///< LTR390_SAMPLE_SATURATED, _UNDERFLOW, _CONFIG_CHANGED
+} ltr390_sample_t;
+
+/*!    @brief  One channel of a snapshot  */
+typedef struct {
+  bool valid;                     ///< False until the channel is first read
+  uint32_t counts;                ///< The reading, as returned by the read
+  uint8_t flags;                  ///< LTR390_SAMPLE_SATURATED etc.
+  uint32_t micros;                ///< clockMicros() when it was read
+  ltr390_gain_t gain;             ///< Gain it was taken at
+  ltr390_resolution_t resolution; ///< Resolution it was taken at
+} ltr390_reading_t;
+
+/*!    @brief  Latest reading of each channel, see getSnapshot()  */
+typedef struct {
+  ltr390_reading_t als; ///< Last ALS reading
+  ltr390_reading_t uvs; ///< Last UVS reading
+  uint32_t sequence;    ///< Readings published so far, to spot new ones
+} ltr390_snapshot_t;
+
+#if defined(__AVR__)
+typedef uint8_t ltr390_seq_t; ///< Snapshot sequence, read in one instruction
+#else
+typedef uint32_t ltr390_seq_t; ///< Snapshot sequence, read in one instruction
+#endif
+
+#ifndef LTR390_SNAPSHOT_TRIES
+#define LTR390_SNAPSHOT_TRIES 4 ///< Copies getSnapshot() tries before failing
+#endif
+
+/*!    @brief  Reads len bytes starting at register reg, true on success  */
+typedef bool (*ltr390_read_fn)(void *context, uint8_t reg, uint8_t *buffer,
+                               size_t len);
+
+/*!    @brief  Writes len bytes starting at register reg, true on success  */
+typedef bool (*ltr390_write_fn)(void *context, uint8_t reg,
+                                const uint8_t *buffer, size_t len);
+
+/*!    @brief  Outcome of a read  */
+typedef enum {
+  LTR390_OK,         ///< Success, with a new reading where applicable
+  LTR390_NO_DATA,    ///< The bus is fine but there is no new reading yet
+  LTR390_RETRY_WAIT, ///< A transaction failed, poll() will retry later
+  LTR390_BUS_ERROR,  ///< A transaction failed (for poll(): retries ran out)
+} ltr390_status_t;
+
+#define LTR390_MAX_RETRIES 16 ///< Most retries a policy may ask for
+
+/*!    @brief  How failed transactions are retried  */
+typedef struct {
+  uint8_t maxRetries;   ///< Retries before giving up
+  uint16_t baseDelayMs; ///< Backoff before the first retry
+  uint16_t maxDelayMs;  ///< Longest backoff, it doubles up to this
+} ltr390_retry_policy_t;
+
+/*!    @brief  Retry counters  */
+typedef struct {
+  uint32_t errors;    ///< Failed transactions
+  uint32_t retries;   ///< Retries made
+  uint32_t recovered; ///< Failures fixed by a retry
+  uint32_t exhausted; ///< Times the retries ran out
+} ltr390_retry_stats_t;
+
+/*!    @brief  Public API calls, for bus traffic statistics  */
+typedef enum {
+  LTR390_OP_NONE, ///< Traffic outside any API call
+  LTR390_OP_BEGIN,
+  LTR390_OP_RESET,
+  LTR390_OP_ENABLE,
+  LTR390_OP_ENABLED,
+  LTR390_OP_SET_MODE,
+  LTR390_OP_GET_MODE,
+  LTR390_OP_SET_GAIN,
+  LTR390_OP_GET_GAIN,
+  LTR390_OP_SET_RESOLUTION,
+  LTR390_OP_GET_RESOLUTION,
+  LTR390_OP_SET_RATE,
+  LTR390_OP_GET_RATE,
+  LTR390_OP_SET_THRESHOLDS,
+  LTR390_OP_CONFIG_INTERRUPT,
+  LTR390_OP_NEW_DATA,
+  LTR390_OP_READ_UVS,
+  LTR390_OP_READ_ALS,
+  LTR390_OP_CALIBRATE_DARK,
+  LTR390_OP_READ_NEW_DATA,
+  LTR390_OP_POLL,
+  LTR390_OP_RESTORE_CONFIG,
+  LTR390_OP_READ_STATUS,
+  LTR390_OP_TAKE_STATUS,
+  LTR390_OP_COUNT, ///< Number of entries, not an API call
+} ltr390_op_t;
+
+/*!    @brief  Bus traffic caused by one API call  */
+typedef struct {
+  uint32_t calls;        ///< Times the call was made
+  uint32_t transactions; ///< I2C transactions
+  uint32_t bytesRead;    ///< Data bytes read
+  uint32_t bytesWritten; ///< Bytes written, including register addresses
+  uint32_t busMicros;    ///< Time spent inside the transport
+  uint32_t lockMicros;   ///< Time the bus lock was held, see setBusLock()
+} ltr390_bus_stats_t;
+
+/*!    @brief  Histogram of bus transaction durations  */
+typedef struct {
+  uint32_t buckets[LTR390_HISTOGRAM_BUCKETS]; ///< [n]: 2^(n-1) <= us < 2^n
+  uint32_t maxMicros;                         ///< Longest transaction seen
+} ltr390_histogram_t;
+
+/*!    @brief  Time source for every delay and timestamp in the driver  */
+typedef struct {
+  uint32_t (*millis)(void *context);         ///< Milliseconds, wrapping
+  uint32_t (*micros)(void *context);         ///< Microseconds, wrapping
+  void (*delay)(void *context, uint32_t ms); ///< Block for ms milliseconds
+  void *context;                             ///< Passed to each function
+} ltr390_clock_t;
+
+/*!    @brief  Bus lock hook, see Adafruit_LTR390::setBusLock()  */
+typedef struct {
+  void (*lock)(void *context);   ///< Wait for and take the lock, recursively
+  void (*unlock)(void *context); ///< Release the lock once
+  void *context;                 ///< Passed to each function
+} ltr390_bus_lock_t;
+
+/*!    @brief  How long API calls held the bus lock  */
+typedef struct {
+  uint32_t holds;      ///< API calls that took the lock
+  uint32_t holdMicros; ///< Total time held
+  uint32_t maxMicros;  ///< Longest time held by one call
+  uint32_t lastMicros; ///< Time held by the last call
+} ltr390_lock_stats_t;
+
+class Adafruit_LTR390_Trace;
+
 /*!
  *    @brief  Class that stores state and functions for interacting with
  *            LTR390 UV Sensor
@@ -67,35 +270,233 @@ typedef enum {
 class Adafruit_LTR390 {
 public:
   Adafruit_LTR390();
+#if defined(ARDUINO)
   bool begin(TwoWire *theWire = &Wire);
+  bool begin(TwoWire *theWire, uint8_t addr, uint32_t frequency = 0);
+  uint32_t busFrequency(void);
+  void setBusDevice(Adafruit_I2CDevice *dev);
+#endif
+  bool begin(ltr390_read_fn readfn, ltr390_write_fn writefn, void *context);
+
+  /*!
+   *  @brief  Setups the LTR390 on a custom bus, e.g. Adafruit_LTR390_LinuxI2C
+   *          or a simulated sensor. A read and a write function for T are
+   *          generated at compile time and the driver calls them through
+   *          function pointers, one indirect call per transaction. The
+   *          transport needs no base class, virtual functions or heap
+   *  @param  transport Any object with bool read(uint8_t reg, uint8_t *buf,
+   *          size_t n) and bool write(uint8_t reg, const uint8_t *buf,
+   *          size_t n) methods. Must outlive the driver
+   *  @return True if initialization was successful, otherwise false.
+   */
+  template <class T> bool beginTransport(T *transport) {
+    return begin(transportRead<T>, transportWrite<T>, transport);
+  }
   bool reset(void);
 
+  void setClock(const ltr390_clock_t *clock);
+  uint32_t clockMillis(void);
+  uint32_t clockMicros(void);
+  void clockDelay(uint32_t ms);
+
   void enable(bool en);
   bool enabled(void);
 
-  void setMode(ltr390_mode_t mode);
+  bool setMode(ltr390_mode_t mode);
   ltr390_mode_t getMode(void);
 
-  void setGain(ltr390_gain_t gain);
+  bool setGain(ltr390_gain_t gain);
   ltr390_gain_t getGain(void);
 
-  void setResolution(ltr390_resolution_t res);
+  bool setResolution(ltr390_resolution_t res);
   ltr390_resolution_t getResolution(void);
 
+  bool setMeasurementRate(ltr390_rate_t rate);
+  ltr390_rate_t getMeasurementRate(void);
+
   void setThresholds(uint32_t lower, uint32_t higher);
 
   void configInterrupt(bool enable, ltr390_mode_t source,
                        uint8_t persistance = 0);
 
   bool newDataAvailable(void);
+  uint8_t readStatus(void);
+  uint8_t latchedStatus(void);
+  bool takeDataReady(void);
+  bool takeInterrupt(void);
+  bool takePowerOn(void);
   uint32_t readUVS(void);
   uint32_t readALS(void);
+  bool readUVS(ltr390_sample_t *sample);
+  bool readALS(ltr390_sample_t *sample);
+  bool readNewData(ltr390_sample_t *sample);
+  bool getSnapshot(ltr390_snapshot_t *snapshot);
+  ltr390_status_t poll(ltr390_sample_t *sample);
+  ltr390_status_t lastStatus(void);
+
+  void setRetryPolicy(const ltr390_retry_policy_t *policy);
+  void getRetryStats(ltr390_retry_stats_t *stats);
+  void resetRetryStats(void);
+
+  bool restoreConfig(void);
+  uint32_t powerOnCount(void);
+
+  void setUnderflowThreshold(uint32_t counts);
+
+  void setReadCache(bool enable);
+  uint32_t cacheHits(void);
+
+  void getBusStats(ltr390_op_t op, ltr390_bus_stats_t *stats);
+  void resetBusStats(void);
+  void getBusHistogram(ltr390_histogram_t *histogram);
+  void resetBusHistogram(void);
+  void setTrace(Adafruit_LTR390_Trace *trace);
+
+  void setBusLock(const ltr390_bus_lock_t *lock);
+  void getLockStats(ltr390_lock_stats_t *stats);
+  void resetLockStats(void);
+
+  bool calibrateDark(ltr390_gain_t gain, ltr390_resolution_t res,
+                     uint8_t samples = 8);
+  void setDarkOffset(ltr390_gain_t gain, ltr390_resolution_t res,
+                     uint16_t counts);
+  uint16_t getDarkOffset(ltr390_gain_t gain, ltr390_resolution_t res);
+  size_t saveDarkOffsets(uint8_t *buffer, size_t len);
+  bool loadDarkOffsets(const uint8_t *buffer, size_t len);
+
+  static uint32_t conversionMicros(ltr390_resolution_t res);
+  static uint32_t rateMicros(ltr390_rate_t rate);
+  static uint32_t periodMicros(ltr390_resolution_t res, ltr390_rate_t rate);
+
+  /*!
+   *  @brief  Get the full scale reading for a resolution
+   *  @param  res The resolution
+   *  @returns The largest count the sensor can report, e.g. 2^20-1 at 20 bit
+   */
+  static constexpr uint32_t fullScale(ltr390_resolution_t res) {
+    return (res == LTR390_RESOLUTION_13BIT) ? 0x1FFFUL : (0xFFFFFUL >> res);
+  }
 
 private:
-  Adafruit_I2CRegister *StatusReg;
-  Adafruit_I2CRegisterBits *DataReadyBit;
+  template <class T>
+  static bool transportRead(void *context, uint8_t reg, uint8_t *buffer,
+                            size_t len) {
+    return static_cast<T *>(context)->read(reg, buffer, len);
+  }
+  template <class T>
+  static bool transportWrite(void *context, uint8_t reg,
+                             const uint8_t *buffer, size_t len) {
+    return static_cast<T *>(context)->write(reg, buffer, len);
+  }
+
+  bool readRegister(uint8_t reg, uint8_t *buffer, size_t len);
+  bool writeRegister(uint8_t reg, const uint8_t *buffer, size_t len);
+  uint8_t readBits(uint8_t reg, uint8_t bits, uint8_t shift);
+  bool writeBits(uint8_t reg, uint8_t bits, uint8_t shift, uint8_t data);
+
+  bool readSample(uint8_t reg, ltr390_sample_t *sample);
+  void decodeSample(const uint8_t *buffer, ltr390_sample_t *sample);
+  void publish(uint8_t reg, const ltr390_sample_t *sample, uint32_t micros);
+  ltr390_status_t burstRead(ltr390_sample_t *sample);
+  bool statusRead(uint8_t *buffer, size_t len);
+  bool latchStatus(uint8_t status);
+  void updatePhase(uint8_t status, uint32_t start, uint32_t end);
+  bool cacheFresh(uint32_t now);
+  void dropCache(void);
+  void updateDarkOffset(void);
+  void shadowDefaults(void);
+  void shadowWrite(uint8_t reg, const uint8_t *buffer, size_t len);
+
+  ltr390_mode_t _mode;             ///< Last mode written
+  ltr390_gain_t _gain;             ///< Last gain written
+  ltr390_resolution_t _resolution; ///< Last resolution written
+  uint32_t _underflow;             ///< Readings at or below this underflow
+  uint8_t _configChanged;          ///< Readings still to flag as stale
 
-  Adafruit_I2CDevice *i2c_dev;
+  uint8_t _mainCtrl;      ///< MAIN_CTRL as last written
+  uint8_t _measRate;      ///< MEAS_RATE as last written
+  uint8_t _gainReg;       ///< GAIN as last written
+  uint8_t _intCfg;        ///< INT_CFG as last written
+  uint8_t _intPst;        ///< INT_PST as last written
+  uint8_t _thresholds[6]; ///< THRESH_UP then THRESH_LOW as last written
+  uint8_t _status;        ///< MAIN_STATUS flags read but not yet taken
+  bool _restorePending;   ///< Power-on seen, config not yet restored
+  uint32_t _powerOns;     ///< Power-on events seen
+
+  bool _readCache;       ///< Read coalescing enabled
+  bool _cacheValid;      ///< _cacheData holds a reading
+  bool _phaseValid;      ///< _phaseLow/_phaseHigh are known
+  bool _noDataValid;     ///< _noDataAt is known
+  uint8_t _cacheData[3]; ///< Data register of the current mode, raw
+  uint32_t _cacheAt;     ///< clockMicros() when _cacheData read began
+  uint32_t _statusAt;    ///< clockMicros() when the last status read began
+  uint32_t _noDataAt;    ///< Start of the last status read without new data
+  uint32_t _phaseLow;    ///< The last conversion ended after this...
+  uint32_t _phaseHigh;   ///< ...and before this, in clockMicros()
+  uint32_t _cacheHits;   ///< Reads served from _cacheData
+  uint8_t _phaseSkip;    ///< New data flags to ignore after a change
+
+  ltr390_seq_t _snapSeq;       ///< Odd while _snapshot is being written
+  ltr390_snapshot_t _snapshot; ///< Latest readings, behind _snapSeq
+
+  uint16_t _darkOffsets[5][6]; ///< Dark counts by gain and resolution
+  uint16_t _darkOffset;        ///< Entry for the current gain and resolution
+
+  ltr390_read_fn _read;          ///< Transport register read
+  ltr390_write_fn _write;        ///< Transport register write
+  void *_context;                ///< Transport object
+  ltr390_clock_t _clock;         ///< Time source
+  Adafruit_LTR390_Trace *_trace; ///< Bus trace recorder, or NULL
+
+  ltr390_status_t _lastStatus;        ///< Outcome of the last read
+  ltr390_retry_policy_t _retryPolicy; ///< How to retry
+  ltr390_retry_stats_t _retryStats;   ///< Retry counters
+  uint8_t _retryAttempt;              ///< Retries so far for poll()
+  uint32_t _retryAt;                  ///< clockMillis() of the next retry
+
+  void busDone(uint32_t us, size_t rd, size_t wr);
+  void busDelay(uint32_t ms);
+
+#if LTR390_BUS_HISTOGRAM
+  ltr390_histogram_t _histogram; ///< Transaction durations
+#endif
+
+  /*!    @brief  Holds the bus lock for a public API call, and charges bus
+   *             traffic to the outermost running call  */
+  class OpScope {
+  public:
+    OpScope(Adafruit_LTR390 *ltr, ltr390_op_t op);
+    ~OpScope();
+
+  private:
+    Adafruit_LTR390 *_ltr; ///< The driver
+    bool _outer;           ///< True if this is the outermost call
+  };
+
+  ltr390_op_t _op;                ///< Running API call
+  uint8_t _depth;                 ///< Nested API calls running
+  ltr390_bus_lock_t _busLock;     ///< Bus lock hook, lock is NULL if none
+  uint32_t _holdStart;            ///< clockMicros() when the lock was taken
+  uint32_t _callHold;             ///< Lock held so far by the running call
+  ltr390_lock_stats_t _lockStats; ///< Lock hold times
+
+#if LTR390_BUS_STATS
+  ltr390_bus_stats_t _busStats[LTR390_OP_COUNT]; ///< Traffic per API call
+#endif
+
+#if defined(ARDUINO)
+  static bool i2cRead(void *context, uint8_t reg, uint8_t *buffer,
+                      size_t len);
+  static bool i2cWrite(void *context, uint8_t reg, const uint8_t *buffer,
+                       size_t len);
+
+  bool probeSpeed(uint32_t frequency);
+
+  Adafruit_I2CDevice *i2c_dev = NULL;
+  uint32_t _busHz = 0; ///< Bus clock chosen by begin(), 0 if left alone
+
+  Adafruit_I2CDevice *_busDev = NULL; ///< Re-begun by reset(), or NULL
+#endif
 };
 
 #endif
@@ -0,0 +1,186 @@
+/*!
+ *  @file Adafruit_LTR390_Budget.cpp
+ *
+ * 	I2C bus load planner for fleets of LTR390 UV and light sensors
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#include "Adafruit_LTR390_Budget.h"
+
+/*!
+ *    @brief  Instantiates a plan with no sensors, checked with readNewData()
+ *            once per reading
+ *    @param  busHz The SCL clock
+ */
+Adafruit_LTR390_Budget::Adafruit_LTR390_Budget(uint32_t busHz)
+    : _count(0), _busHz(busHz), _access(LTR390_ACCESS_BURST), _pollMicros(0),
+      _mux(false) {}
+
+/*!
+ *  @brief  Set the SCL clock
+ *  @param  hz The clock, e.g. 100000 or 400000
+ */
+void Adafruit_LTR390_Budget::setBusClock(uint32_t hz) { _busHz = hz; }
+
+/*!
+ *  @brief  Set how the application checks the sensors for new data
+ *  @param  access Which driver calls it uses
+ *  @param  pollMicros Time between checks of each sensor, or 0 if each
+ *  check is woken by the sensor's INT pin, one per reading
+ */
+void Adafruit_LTR390_Budget::setAccess(ltr390_access_t access,
+                                       uint32_t pollMicros) {
+  _access = access;
+  _pollMicros = pollMicros;
+}
+
+/*!
+ *  @brief  Set whether the sensors sit behind a TCA9548A, one per channel,
+ *  and are checked in Adafruit_LTR390_Mux::sampleRound() rounds. A round
+ *  starts every pollMicros, or every shortest sensor period if that is 0
+ *  @param  mux True for a mux
+ */
+void Adafruit_LTR390_Budget::setMux(bool mux) { _mux = mux; }
+
+/*!
+ *  @brief  Add a sensor to the bus
+ *  @param  mode LTR390_MODE_ALS or LTR390_MODE_UVS
+ *  @param  res The resolution
+ *  @param  rate The measurement rate
+ *  @returns Index of the sensor for sensorLoad(), or -1 if the plan is full
+ */
+int8_t Adafruit_LTR390_Budget::addSensor(ltr390_mode_t mode,
+                                         ltr390_resolution_t res,
+                                         ltr390_rate_t rate) {
+  if (_count >= LTR390_BUDGET_SENSORS) {
+    return -1;
+  }
+  _sensors[_count].mode = mode;
+  _sensors[_count].resolution = res;
+  _sensors[_count].rate = rate;
+  return _count++;
+}
+
+/*!
+ *  @brief  Get the number of sensors added
+ *  @returns Sensors, indexed from 0
+ */
+uint8_t Adafruit_LTR390_Budget::sensors(void) { return _count; }
+
+/*!
+ *  @brief  Remove every sensor, keeping the bus settings
+ */
+void Adafruit_LTR390_Budget::clear(void) { _count = 0; }
+
+/*!
+ *  @brief  Get the traffic one sensor causes, not counting mux switches
+ *  @param  index The sensor, from addSensor()
+ *  @param  load Where to put the traffic per second
+ */
+void Adafruit_LTR390_Budget::sensorLoad(uint8_t index, ltr390_budget_t *load) {
+  memset(load, 0, sizeof(*load));
+  if (index >= _count) {
+    return;
+  }
+  const ltr390_budget_sensor_t *sensor = &_sensors[index];
+
+  float readings = 1e6f / Adafruit_LTR390::periodMicros(sensor->resolution,
+                                                        sensor->rate);
+  uint32_t interval = _mux ? roundMicros() : _pollMicros;
+  load->checks = interval ? 1e6f / interval : readings;
+  // a check after more than one period still only finds the latest reading
+  load->dataReads = (load->checks < readings) ? load->checks : readings;
+
+  if (_access == LTR390_ACCESS_BURST) {
+    // MAIN_STATUS through the end of the data register, see burstRead()
+    uint8_t data =
+        (sensor->mode == LTR390_MODE_UVS) ? LTR390_UVSDATA : LTR390_ALSDATA;
+    load->bits = load->checks * readBits(data + 3 - LTR390_MAIN_STATUS);
+  } else {
+    load->bits = load->checks * readBits(1) + load->dataReads * readBits(3);
+  }
+  load->utilisation = _busHz ? load->bits / _busHz : 0;
+}
+
+/*!
+ *  @brief  Get the traffic of every sensor together, plus mux switches
+ *  @param  load Where to put the traffic per second
+ */
+void Adafruit_LTR390_Budget::busLoad(ltr390_budget_t *load) {
+  memset(load, 0, sizeof(*load));
+  for (uint8_t i = 0; i < _count; i++) {
+    ltr390_budget_t sensor;
+    sensorLoad(i, &sensor);
+    load->checks += sensor.checks;
+    load->dataReads += sensor.dataReads;
+    load->bits += sensor.bits;
+  }
+  if (_mux && (_count > 1)) {
+    // sampleRound() goes back and forth, so the first channel of a round is
+    // the one the previous round ended on
+    load->muxSwitches = (_count - 1) * 1e6f / roundMicros();
+    load->bits += load->muxSwitches * writeBits(0);
+  }
+  load->utilisation = _busHz ? load->bits / _busHz : 0;
+}
+
+/*!
+ *  @brief  Check the plan against a utilisation target
+ *  @param  target Highest acceptable fraction of bus time, e.g. 0.5
+ *  @returns True if busLoad() stays at or under the target
+ */
+bool Adafruit_LTR390_Budget::fits(float target) {
+  ltr390_budget_t load;
+  busLoad(&load);
+  return load.utilisation <= target;
+}
+
+/*!
+ *  @brief  Bit times of a register read: start, address with write, register,
+ *  repeated start, address with read, the data, stop. Each byte is 9 bits
+ *  with its ACK
+ *  @param  len Bytes read
+ *  @returns Bit times
+ */
+uint32_t Adafruit_LTR390_Budget::readBits(size_t len) {
+  return 1 + 9 + 9 + 1 + 9 + 9 * len + 1;
+}
+
+/*!
+ *  @brief  Bit times of a register write: start, address, register, data,
+ *  stop. A mux switch is a write of no data, its channel mask taking the
+ *  place of the register
+ *  @param  len Bytes written after the register
+ *  @returns Bit times
+ */
+uint32_t Adafruit_LTR390_Budget::writeBits(size_t len) {
+  return 1 + 9 + 9 + 9 * len + 1;
+}
+
+/*!
+ *  @brief  Time between mux rounds
+ *  @returns pollMicros, or the shortest sensor period if that is 0
+ */
+uint32_t Adafruit_LTR390_Budget::roundMicros(void) {
+  if (_pollMicros) {
+    return _pollMicros;
+  }
+  uint32_t shortest = 0;
+  for (uint8_t i = 0; i < _count; i++) {
+    uint32_t period = Adafruit_LTR390::periodMicros(_sensors[i].resolution,
+                                                    _sensors[i].rate);
+    if ((shortest == 0) || (period < shortest)) {
+      shortest = period;
+    }
+  }
+  return shortest;
+}
@@ -0,0 +1,86 @@
+/*!
+ *  @file Adafruit_LTR390_Budget.h
+ *
+ * 	I2C bus load planner for fleets of LTR390 UV and light sensors
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_BUDGET_H
+#define _ADAFRUIT_LTR390_BUDGET_H
+
+#include "Adafruit_LTR390.h"
+
+#define LTR390_BUDGET_SENSORS 16 ///< Most sensors on one planned bus
+
+/*!    @brief  How the application checks each sensor for new data  */
+typedef enum {
+  LTR390_ACCESS_BURST,  ///< readNewData() or poll(), status and data in one
+  LTR390_ACCESS_STATUS, ///< newDataAvailable(), then readALS() or readUVS()
+} ltr390_access_t;
+
+/*!    @brief  One sensor on a planned bus  */
+typedef struct {
+  ltr390_mode_t mode;             ///< Channel read, UVS bursts are longer
+  ltr390_resolution_t resolution; ///< Sets the conversion time
+  ltr390_rate_t rate;             ///< Measurement rate
+} ltr390_budget_sensor_t;
+
+/*!    @brief  Expected bus traffic per second  */
+typedef struct {
+  float checks;      ///< Status reads, or bursts, that look for new data
+  float dataReads;   ///< New readings, read apart from the status only with
+                     ///< LTR390_ACCESS_STATUS
+  float muxSwitches; ///< TCA9548A control writes
+  float bits;        ///< Bit times used, start, stop and ACKs included
+  float utilisation; ///< Fraction of the bus clock used, 0 to 1 and beyond
+} ltr390_budget_t;
+
+/*!
+ *    @brief  Works out how busy an I2C bus will be from the transactions the
+ *            driver makes, without touching any hardware. Give it the bus
+ *            clock, how sensors are checked and the sensors, then compare
+ *            busLoad() against a target utilisation with fits(). Counts
+ *            only time on the wire, not gaps between transactions, so keep
+ *            the target well under 1.
+ */
+class Adafruit_LTR390_Budget {
+public:
+  Adafruit_LTR390_Budget(uint32_t busHz = 100000);
+
+  void setBusClock(uint32_t hz);
+  void setAccess(ltr390_access_t access, uint32_t pollMicros = 0);
+  void setMux(bool mux);
+
+  int8_t addSensor(ltr390_mode_t mode, ltr390_resolution_t res,
+                   ltr390_rate_t rate);
+  uint8_t sensors(void);
+  void clear(void);
+
+  void sensorLoad(uint8_t index, ltr390_budget_t *load);
+  void busLoad(ltr390_budget_t *load);
+  bool fits(float target);
+
+  static uint32_t readBits(size_t len);
+  static uint32_t writeBits(size_t len);
+
+private:
+  uint32_t roundMicros(void);
+
+  ltr390_budget_sensor_t _sensors[LTR390_BUDGET_SENSORS]; ///< The sensors
+  uint8_t _count;                                         ///< Sensors added
+  uint32_t _busHz;                                        ///< SCL clock
+  ltr390_access_t _access;                                ///< How checked
+  uint32_t _pollMicros; ///< Time between checks, 0 for one per reading
+  bool _mux;            ///< Sensors are behind a TCA9548A
+};
+
+#endif
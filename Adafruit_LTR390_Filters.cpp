@@ -0,0 +1,85 @@
+/*!
+ *  @file Adafruit_LTR390_Filters.cpp
+ *
+ * 	Sample filters for the LTR390 UV and light sensor
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Adafruit_LTR390_Filters.h"
+
+/*!
+ *    @brief  Instantiates a new decimator
+ *    @param  ratio Number of readings summed into each output, 1 to
+ *            LTR390_DECIMATE_MAX
+ */
+Adafruit_LTR390_Decimator::Adafruit_LTR390_Decimator(uint8_t ratio) {
+  setRatio(ratio);
+}
+
+/*!
+ *  @brief  Set the decimation ratio, this also drops any partial block
+ *  @param  ratio Number of readings summed into each output, 1 to
+ *          LTR390_DECIMATE_MAX
+ */
+void Adafruit_LTR390_Decimator::setRatio(uint8_t ratio) {
+  if (ratio < 1) {
+    ratio = 1;
+  }
+  if (ratio > LTR390_DECIMATE_MAX) {
+    ratio = LTR390_DECIMATE_MAX;
+  }
+  _ratio = ratio;
+  reset();
+}
+
+/*!
+ *  @brief  Get the decimation ratio
+ *  @returns Number of readings summed into each output
+ */
+uint8_t Adafruit_LTR390_Decimator::getRatio(void) { return _ratio; }
+
+/*!
+ *  @brief  Drop the partial block and the last output
+ */
+void Adafruit_LTR390_Decimator::reset(void) {
+  _sum = 0;
+  _output = 0;
+  _count = 0;
+}
+
+/*!
+ *  @brief  Feed one reading into the decimator
+ *  @param  counts A raw reading, as returned by readALS() or readUVS()
+ *  @returns True when this reading completed a block and a new output is
+ *  ready in read()
+ */
+bool Adafruit_LTR390_Decimator::push(uint32_t counts) {
+  _sum += counts;
+  if (++_count < _ratio) {
+    return false;
+  }
+  _output = _sum;
+  _sum = 0;
+  _count = 0;
+  return true;
+}
+
+/*!
+ *  @brief  Get the last complete output
+ *  @returns The sum of the last 'ratio' readings. A 13 bit input with ratio
+ *  16 gives a 17 bit output
+ */
+uint32_t Adafruit_LTR390_Decimator::read(void) { return _output; }
+
+/*!
+ *  @brief  Get the last complete output scaled back to the input range
+ *  @returns The mean of the last 'ratio' readings
+ */
+float Adafruit_LTR390_Decimator::readAverage(void) {
+  return (float)_output / _ratio;
+}
@@ -0,0 +1,176 @@
+/*!
+ *  @file Adafruit_LTR390_Filters.h
+ *
+ * 	Sample filters for the LTR390 UV and light sensor
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_FILTERS_H
+#define _ADAFRUIT_LTR390_FILTERS_H
+
+#include "Adafruit_LTR390.h"
+
+#define LTR390_DECIMATE_MAX 64 ///< Largest supported decimation ratio
+
+/*!    @brief  Output of a spike-rejecting filter stage  */
+typedef struct {
+  uint32_t value; ///< The reading, or the window median if it was an outlier
+  bool replaced;  ///< True if the reading was an outlier and was replaced
+} ltr390_filtered_t;
+
+/*!
+ *    @brief  Boxcar (first order CIC) decimator. Sums every 'ratio' fast, low
+ *            resolution readings into one slower reading with log2(ratio)
+ *            extra bits.
+ *
+ *    At 13 bit the conversion takes 12.5ms, but the fastest measurement rate
+ *    is 25ms, so new readings arrive every 25ms. Compared with the native 20
+ *    bit mode (one 400ms conversion):
+ *     - ratio 16 gives one 17 bit reading every 400ms, the same latency, with
+ *       white noise down by 4x relative to a single 13 bit reading
+ *     - ratio 4 gives one 15 bit reading every 100ms, 4x lower latency than
+ *       20 bit, with 2x less noise than a single 13 bit reading
+ *    Each 13 bit conversion only covers 12.5ms of the 25ms period, so the
+ *    decimated output sees half the light a 20 bit reading would.
+ */
+class Adafruit_LTR390_Decimator {
+public:
+  Adafruit_LTR390_Decimator(uint8_t ratio = 16);
+
+  void setRatio(uint8_t ratio);
+  uint8_t getRatio(void);
+  void reset(void);
+
+  bool push(uint32_t counts);
+  uint32_t read(void);
+  float readAverage(void);
+
+private:
+  uint32_t _sum;    ///< Running sum of the current block
+  uint32_t _output; ///< Last complete block sum
+  uint8_t _ratio;   ///< Number of readings per output
+  uint8_t _count;   ///< Readings in the current block
+};
+
+/*!
+ *    @brief  Causal Hampel filter over the last WINDOW readings. Each new
+ *            reading is compared with the window median, and replaced by the
+ *            median if it is more than 'nsigma' robust standard deviations
+ *            (1.5 * median absolute deviation) away. The window is kept both
+ *            in arrival order and sorted, so each push costs O(WINDOW) with
+ *            no allocation.
+ *    @tparam WINDOW Number of readings in the window, 3 to 255
+ */
+template <uint8_t WINDOW> class Adafruit_LTR390_Hampel {
+  static_assert(WINDOW >= 3, "Hampel window must hold at least 3 readings");
+
+public:
+  /*!
+   *  @brief  Instantiates a new Hampel filter
+   *  @param  nsigma Outlier threshold in robust standard deviations
+   *  @param  min_deviation Readings this close to the median are never
+   *          replaced, which stops a flat window (MAD of 0) flagging noise
+   */
+  Adafruit_LTR390_Hampel(uint8_t nsigma = 3, uint32_t min_deviation = 0)
+      : _nsigma(nsigma), _minDeviation(min_deviation) {
+    reset();
+  }
+
+  /*!
+   *  @brief  Empty the window
+   */
+  void reset(void) {
+    _head = 0;
+    _count = 0;
+  }
+
+  /*!
+   *  @brief  Feed one reading through the filter
+   *  @param  counts A raw reading, as returned by readALS() or readUVS()
+   *  @returns The filtered reading and whether it was replaced
+   */
+  ltr390_filtered_t push(uint32_t counts) {
+    if (_count == WINDOW) {
+      remove(_ring[_head]);
+    } else {
+      _count++;
+    }
+    insert(counts);
+    _ring[_head] = counts;
+    _head = (_head + 1) % WINDOW;
+
+    ltr390_filtered_t out = {counts, false};
+    if (_count < 3) {
+      return out;
+    }
+
+    uint32_t median = _sorted[_count / 2];
+    uint32_t dev = (counts > median) ? counts - median : median - counts;
+    if ((dev > _minDeviation) &&
+        ((uint64_t)dev * 2 > (uint64_t)_nsigma * 3 * mad(median))) {
+      out.value = median;
+      out.replaced = true;
+    }
+    return out;
+  }
+
+private:
+  // Drop one copy of value from the sorted window
+  void remove(uint32_t value) {
+    uint8_t i = 0;
+    while ((i < _count - 1) && (_sorted[i] != value)) {
+      i++;
+    }
+    for (; i < _count - 1; i++) {
+      _sorted[i] = _sorted[i + 1];
+    }
+  }
+
+  // Insert value into the sorted window, which has _count - 1 entries
+  void insert(uint32_t value) {
+    uint8_t i = _count - 1;
+    while ((i > 0) && (_sorted[i - 1] > value)) {
+      _sorted[i] = _sorted[i - 1];
+      i--;
+    }
+    _sorted[i] = value;
+  }
+
+  // Median absolute deviation, walking outwards from the median so the
+  // deviations come out already sorted
+  uint32_t mad(uint32_t median) {
+    int16_t lo = _count / 2 - 1;
+    int16_t hi = _count / 2 + 1;
+    uint32_t dev = 0;
+    for (uint8_t k = 0; k < _count / 2; k++) {
+      uint32_t dlo = (lo >= 0) ? median - _sorted[lo] : UINT32_MAX;
+      uint32_t dhi = (hi < _count) ? _sorted[hi] - median : UINT32_MAX;
+      if (dlo <= dhi) {
+        dev = dlo;
+        lo--;
+      } else {
+        dev = dhi;
+        hi++;
+      }
+    }
+    return dev;
+  }
+
+  uint32_t _ring[WINDOW];   ///< Readings in arrival order
+  uint32_t _sorted[WINDOW]; ///< The same readings, sorted
+  uint8_t _head;            ///< Next slot to overwrite in _ring
+  uint8_t _count;           ///< Readings in the window
+  uint8_t _nsigma;          ///< Outlier threshold in robust sigmas
+  uint32_t _minDeviation;   ///< Deviations at or below this are kept
+};
+
+#endif
@@ -0,0 +1,207 @@
+/*!
+ *  @file Adafruit_LTR390_Flicker.cpp
+ *
+ * 	Light flicker detection for the LTR390 UV and light sensor
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Adafruit_LTR390_Flicker.h"
+#include <math.h>
+
+// Targets the integration window scales below this are not detectable
+#define LTR390_FLICKER_MIN_WINDOW 0.05f
+
+/*!
+ *    @brief  Instantiates a new flicker detector with no targets
+ */
+Adafruit_LTR390_Flicker::Adafruit_LTR390_Flicker(void)
+    : _ltr(NULL), _bins(0) {
+  start();
+}
+
+/*!
+ *  @brief  Put the sensor in the fastest mode (ALS, 13 bit, 25ms) and start
+ *  a new block
+ *  @param  ltr The sensor, which must already be begin()'d
+ *  @returns True if the sensor took the settings, false if a bus write failed
+ */
+bool Adafruit_LTR390_Flicker::begin(Adafruit_LTR390 *ltr) {
+  _ltr = ltr;
+  start();
+  return _ltr->setMode(LTR390_MODE_ALS) &&
+         _ltr->setResolution(LTR390_RESOLUTION_13BIT) &&
+         _ltr->setMeasurementRate(LTR390_RATE_25MS);
+}
+
+/*!
+ *  @brief  Add a frequency to check, e.g. 100 or 120 for mains flicker
+ *  @param  hz The flicker frequency in Hz
+ *  @returns False if LTR390_FLICKER_BINS targets are already in use
+ */
+bool Adafruit_LTR390_Flicker::addTarget(float hz) {
+  if (_bins >= LTR390_FLICKER_BINS) {
+    return false;
+  }
+
+  // fold into 0..fs/2
+  float alias = fmodf(hz, LTR390_FLICKER_RATE);
+  if (alias > LTR390_FLICKER_RATE / 2) {
+    alias = LTR390_FLICKER_RATE - alias;
+  }
+
+  _alias[_bins] = alias;
+  // each 13 bit reading averages the light over its conversion time
+  float x = (float)M_PI * hz *
+            Adafruit_LTR390::conversionMicros(LTR390_RESOLUTION_13BIT) / 1e6f;
+  _window[_bins] = (x > 0) ? fabsf(sinf(x) / x) : 1.0f;
+  _coeff[_bins] = lroundf(2.0f * cosf(2.0f * (float)M_PI * alias /
+                                      LTR390_FLICKER_RATE) *
+                          16384);
+  _bins++;
+  start();
+  return true;
+}
+
+/*!
+ *  @brief  Throw away the current block and start capturing a new one
+ */
+void Adafruit_LTR390_Flicker::start(void) {
+  _count = 0;
+  _sum = 0;
+  _start = 0;
+  for (uint8_t b = 0; b < LTR390_FLICKER_BINS; b++) {
+    _s1[b] = 0;
+    _s2[b] = 0;
+  }
+}
+
+/*!
+ *  @brief  Check the sensor and fold in a new reading if there is one. Call
+ *  this more often than every 25ms
+ *  @returns True once the block is complete
+ */
+bool Adafruit_LTR390_Flicker::poll(void) {
+  if (complete()) {
+    return true;
+  }
+  if (!_ltr->newDataAvailable()) {
+    return false;
+  }
+
+  ltr390_sample_t reading;
+  if (!_ltr->readALS(&reading)) {
+    return false;
+  }
+  if (reading.flags & LTR390_SAMPLE_CONFIG_CHANGED) {
+    return false; // may be from before begin()
+  }
+
+  uint32_t now = _ltr->clockMillis();
+  if (_count == 0) {
+    _start = now;
+  }
+
+  uint16_t x = reading.counts;
+  _samples[_count] = x;
+  _times[_count] = now - _start;
+  _sum += x;
+  _count++;
+
+  for (uint8_t b = 0; b < _bins; b++) {
+    int32_t s = x + (int32_t)(((int64_t)_coeff[b] * _s1[b]) >> 14) - _s2[b];
+    _s2[b] = _s1[b];
+    _s1[b] = s;
+  }
+
+  return complete();
+}
+
+/*!
+ *  @brief  Check if the block is complete
+ *  @returns True once LTR390_FLICKER_SAMPLES readings have been captured
+ */
+bool Adafruit_LTR390_Flicker::complete(void) {
+  return _count >= LTR390_FLICKER_SAMPLES;
+}
+
+/*!
+ *  @brief  Check if a target can be seen at all at the sensor's sample rate
+ *  @param  bin Index of the target, in the order they were added
+ *  @returns False if the target aliases onto DC, or the integration window
+ *  all but cancels it
+ */
+bool Adafruit_LTR390_Flicker::detectable(uint8_t bin) {
+  return (bin < _bins) &&
+         (_alias[bin] >= (float)LTR390_FLICKER_RATE / LTR390_FLICKER_SAMPLES) &&
+         (_window[bin] >= LTR390_FLICKER_MIN_WINDOW);
+}
+
+/*!
+ *  @brief  Get the frequency a target shows up at after sampling
+ *  @param  bin Index of the target, in the order they were added
+ *  @returns The alias frequency in Hz, 0 to 20
+ */
+float Adafruit_LTR390_Flicker::aliasFrequency(uint8_t bin) {
+  return (bin < _bins) ? _alias[bin] : 0;
+}
+
+/*!
+ *  @brief  Get the modulation depth of a target over the completed block
+ *  @param  bin Index of the target, in the order they were added
+ *  @returns Peak flicker amplitude as a fraction of the mean level (0 to 1),
+ *  corrected for the integration window, or 0 if the block is not complete
+ *  or the target is not detectable. Only a lower bound for targets that
+ *  alias to 20Hz, see the class notes
+ */
+float Adafruit_LTR390_Flicker::modulationDepth(uint8_t bin) {
+  if (!complete() || !detectable(bin) || (_sum == 0)) {
+    return 0;
+  }
+
+  float s1 = _s1[bin], s2 = _s2[bin];
+  float power = s1 * s1 + s2 * s2 - (_coeff[bin] / 16384.0f) * s1 * s2;
+  if (power < 0) {
+    power = 0;
+  }
+
+  // a sine at exactly fs/2 puts all its energy in one bin, not half
+  float scale = (_alias[bin] >= LTR390_FLICKER_RATE / 2) ? 1.0f : 2.0f;
+  float amplitude = scale * sqrtf(power) / _count / _window[bin];
+  float mean = (float)_sum / _count;
+  return amplitude / mean;
+}
+
+/*!
+ *  @brief  Get the sample rate actually achieved over the block, which
+ *  drifts with the sensor's internal oscillator
+ *  @returns Readings per second, or 0 if fewer than 2 readings
+ */
+float Adafruit_LTR390_Flicker::sampleRate(void) {
+  if ((_count < 2) || (_times[_count - 1] == 0)) {
+    return 0;
+  }
+  return (_count - 1) * 1000.0f / _times[_count - 1];
+}
+
+/*!
+ *  @brief  Get one raw reading from the block
+ *  @param  i Index of the reading
+ *  @returns The 13 bit ALS reading
+ */
+uint16_t Adafruit_LTR390_Flicker::sample(uint8_t i) {
+  return (i < _count) ? _samples[i] : 0;
+}
+
+/*!
+ *  @brief  Get the time of one reading in the block
+ *  @param  i Index of the reading
+ *  @returns ms since the first reading of the block
+ */
+uint16_t Adafruit_LTR390_Flicker::timestamp(uint8_t i) {
+  return (i < _count) ? _times[i] : 0;
+}
@@ -0,0 +1,82 @@
+/*!
+ *  @file Adafruit_LTR390_Flicker.h
+ *
+ * 	Light flicker detection for the LTR390 UV and light sensor
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_FLICKER_H
+#define _ADAFRUIT_LTR390_FLICKER_H
+
+#include "Adafruit_LTR390.h"
+
+#define LTR390_FLICKER_SAMPLES 64 ///< ALS readings captured per block
+#define LTR390_FLICKER_BINS 4     ///< Most frequencies checked per block
+#define LTR390_FLICKER_RATE 40    ///< Nominal sample rate in Hz (25ms)
+
+/*!
+ *    @brief  Captures a block of fast 13 bit ALS readings and runs a
+ *            fixed point Goertzel filter per target frequency as each reading
+ *            arrives, so the work per reading is O(1).
+ *
+ *    The LTR390 can not sample faster than every 25ms (40Hz), so flicker
+ *    above 20Hz is seen at its alias frequency: 100Hz appears at 20Hz and
+ *    120Hz lands on DC, where it can not be told apart from steady light.
+ *    Every slower rate the sensor offers divides 40Hz by a power of two,
+ *    so none moves them anywhere better. 20Hz is exactly half the sample
+ *    rate, where each reading hits the same two points of the cycle, so
+ *    the depth reported for 100Hz depends on the phase between the light
+ *    and the sensor's oscillator: anything from the true depth down to 0.
+ *    Treat it as a lower bound. detectable() reports whether a target
+ *    aliases somewhere useful.
+ *
+ *    Each reading integrates the light for 12.5ms, which scales a target's
+ *    amplitude by sinc(f * 12.5ms), 0.18 at 100Hz and 0.21 at 120Hz.
+ *    modulationDepth() divides that back out, and targets near the nulls at
+ *    multiples of 80Hz are not detectable.
+ */
+class Adafruit_LTR390_Flicker {
+public:
+  Adafruit_LTR390_Flicker();
+
+  bool begin(Adafruit_LTR390 *ltr);
+  bool addTarget(float hz);
+  void start(void);
+  bool poll(void);
+
+  bool complete(void);
+  bool detectable(uint8_t bin);
+  float aliasFrequency(uint8_t bin);
+  float modulationDepth(uint8_t bin);
+  float sampleRate(void);
+
+  uint16_t sample(uint8_t i);
+  uint16_t timestamp(uint8_t i);
+
+private:
+  Adafruit_LTR390 *_ltr;
+
+  uint16_t _samples[LTR390_FLICKER_SAMPLES]; ///< Raw 13 bit ALS readings
+  uint16_t _times[LTR390_FLICKER_SAMPLES];   ///< ms since the first reading
+  uint32_t _start;                           ///< clockMillis() of first reading
+  uint32_t _sum;                             ///< Sum of readings, for mean
+  uint8_t _count;                            ///< Readings captured
+
+  float _alias[LTR390_FLICKER_BINS];   ///< Alias frequency of each target
+  float _window[LTR390_FLICKER_BINS];  ///< Integration response at target
+  int32_t _coeff[LTR390_FLICKER_BINS]; ///< 2cos(w) in Q14
+  int32_t _s1[LTR390_FLICKER_BINS];    ///< Goertzel state s[n-1]
+  int32_t _s2[LTR390_FLICKER_BINS];    ///< Goertzel state s[n-2]
+  uint8_t _bins;                       ///< Targets in use
+};
+
+#endif
@@ -0,0 +1,161 @@
+/*!
+ *  @file Adafruit_LTR390_Group.cpp
+ *
+ * 	Samples LTR390 UV and light sensors on several I2C buses in parallel
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#include "Adafruit_LTR390_Group.h"
+
+#if LTR390_THREADS
+
+/*!
+ *    @brief  Instantiates an empty group
+ */
+Adafruit_LTR390_Group::Adafruit_LTR390_Group(void)
+    : _count(0), _busCount(0), _results(NULL), _roundMicros(0) {
+  for (uint8_t b = 0; b < LTR390_GROUP_BUSES; b++) {
+    _buses[b].group = this;
+    _buses[b].bus = b;
+  }
+}
+
+/*!
+ *    @brief  Stops the workers
+ */
+Adafruit_LTR390_Group::~Adafruit_LTR390_Group(void) { stop(); }
+
+/*!
+ *  @brief  Add a sensor, before start()
+ *  @param  bus Which bus it is on, 0 to LTR390_GROUP_BUSES - 1. Sensors on
+ *  the same bus are read one after another, different buses in parallel
+ *  @param  ltr The sensor, already begun
+ *  @returns Index of the sensor in sampleRound() results, or -1 if the group
+ *  is full, running, or bus is out of range
+ */
+int8_t Adafruit_LTR390_Group::addSensor(uint8_t bus, Adafruit_LTR390 *ltr) {
+  if ((bus >= LTR390_GROUP_BUSES) || (_count >= LTR390_GROUP_SENSORS) ||
+      _buses[0].thread.running()) {
+    return -1;
+  }
+  _sensors[_count] = ltr;
+  _sensorBus[_count] = bus;
+  if (bus >= _busCount) {
+    _busCount = bus + 1;
+  }
+  return _count++;
+}
+
+/*!
+ *  @brief  Get the number of sensors added
+ *  @returns Sensors, indexed from 0
+ */
+uint8_t Adafruit_LTR390_Group::sensors(void) { return _count; }
+
+/*!
+ *  @brief  Start one worker per bus
+ *  @param  priority Task priority, FreeRTOS only
+ *  @param  stack Task stack in bytes, FreeRTOS only
+ *  @returns True if every worker started
+ */
+bool Adafruit_LTR390_Group::start(uint8_t priority, uint32_t stack) {
+  if (_buses[0].thread.running() || (_busCount == 0)) {
+    return false;
+  }
+  _stop.set(false);
+  for (uint8_t b = 0; b < _busCount; b++) {
+    if (!_buses[b].thread.start(worker, &_buses[b], "ltr390grp", stack,
+                                priority)) {
+      stop();
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Stop the workers and wait for them to finish
+ */
+void Adafruit_LTR390_Group::stop(void) {
+  _stop.set(true);
+  for (uint8_t b = 0; b < _busCount; b++) {
+    if (_buses[b].thread.running()) {
+      _buses[b].go.signal();
+      _buses[b].thread.join();
+    }
+  }
+}
+
+/*!
+ *  @brief  Sample every sensor once, all buses at the same time. Blocks
+ *  until the slowest bus is done
+ *  @param  results Array indexed like the sensors
+ *  @returns Number of sensors that had a new reading
+ */
+uint8_t Adafruit_LTR390_Group::sampleRound(ltr390_group_result_t *results) {
+  if (!_buses[0].thread.running()) {
+    return 0;
+  }
+  uint32_t start = _sensors[0]->clockMicros();
+  _results = results;
+  for (uint8_t b = 0; b < _busCount; b++) {
+    _buses[b].go.signal();
+  }
+  for (uint8_t b = 0; b < _busCount; b++) {
+    while (!_buses[b].done.wait(1000)) {
+    }
+  }
+  _roundMicros = _sensors[0]->clockMicros() - start;
+
+  uint8_t fresh = 0;
+  for (uint8_t i = 0; i < _count; i++) {
+    if (results[i].status == LTR390_OK) {
+      fresh++;
+    }
+  }
+  return fresh;
+}
+
+/*!
+ *  @brief  Get how long the last sampleRound() took
+ *  @returns Microseconds, by the first sensor's clock
+ */
+uint32_t Adafruit_LTR390_Group::roundMicros(void) { return _roundMicros; }
+
+/*!
+ *  @brief  A bus worker: wait for a round, read this bus's sensors, report
+ *  @param  context The bus_t
+ */
+void Adafruit_LTR390_Group::worker(void *context) {
+  bus_t *bus = (bus_t *)context;
+  Adafruit_LTR390_Group *group = bus->group;
+
+  while (true) {
+    while (!bus->go.wait(1000)) {
+    }
+    if (group->_stop.get()) {
+      return;
+    }
+    for (uint8_t i = 0; i < group->_count; i++) {
+      if (group->_sensorBus[i] != bus->bus) {
+        continue;
+      }
+      ltr390_group_result_t *result = &group->_results[i];
+      group->_sensors[i]->readNewData(&result->sample);
+      result->status = group->_sensors[i]->lastStatus();
+      result->micros = group->_sensors[i]->clockMicros();
+    }
+    bus->done.signal();
+  }
+}
+
+#endif
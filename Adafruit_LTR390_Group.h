@@ -0,0 +1,80 @@
+/*!
+ *  @file Adafruit_LTR390_Group.h
+ *
+ * 	Samples LTR390 UV and light sensors on several I2C buses in parallel
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_GROUP_H
+#define _ADAFRUIT_LTR390_GROUP_H
+
+#include "Adafruit_LTR390_Thread.h"
+
+#if LTR390_THREADS
+
+#define LTR390_GROUP_BUSES 4    ///< Most buses in a group
+#define LTR390_GROUP_SENSORS 16 ///< Most sensors in a group
+
+/*!    @brief  One sensor's part of a sampling round  */
+typedef struct {
+  ltr390_sample_t sample; ///< The reading, if status is LTR390_OK
+  ltr390_status_t status; ///< LTR390_OK, LTR390_NO_DATA or LTR390_BUS_ERROR
+  uint32_t micros;        ///< Sensor's clockMicros() after the read
+} ltr390_group_result_t;
+
+/*!
+ *    @brief  Runs one worker (FreeRTOS task or std::thread) per I2C bus.
+ *            sampleRound() wakes every worker at once, each does a
+ *            readNewData() on the sensors of its bus in turn, and the round
+ *            returns when the slowest bus is done, with the results in one
+ *            batch. Sensors must have begun, and only the group may call
+ *            into them while it runs.
+ */
+class Adafruit_LTR390_Group {
+public:
+  Adafruit_LTR390_Group();
+  ~Adafruit_LTR390_Group();
+
+  int8_t addSensor(uint8_t bus, Adafruit_LTR390 *ltr);
+  uint8_t sensors(void);
+
+  bool start(uint8_t priority = 1, uint32_t stack = 4096);
+  void stop(void);
+
+  uint8_t sampleRound(ltr390_group_result_t *results);
+  uint32_t roundMicros(void);
+
+private:
+  static void worker(void *context);
+
+  /*!    @brief  Per-bus worker state  */
+  typedef struct {
+    Adafruit_LTR390_Group *group;  ///< The group
+    uint8_t bus;                   ///< Bus this worker samples
+    Adafruit_LTR390_Event go;      ///< Starts a round
+    Adafruit_LTR390_Event done;    ///< The round is finished on this bus
+    Adafruit_LTR390_Thread thread; ///< The worker
+  } bus_t;
+
+  bus_t _buses[LTR390_GROUP_BUSES];                ///< Workers by bus
+  Adafruit_LTR390 *_sensors[LTR390_GROUP_SENSORS]; ///< The sensors
+  uint8_t _sensorBus[LTR390_GROUP_SENSORS];        ///< Bus of each sensor
+  uint8_t _count;                                  ///< Sensors added
+  uint8_t _busCount;                               ///< Highest bus used + 1
+  ltr390_group_result_t *_results;                 ///< The running round
+  uint32_t _roundMicros;                           ///< Last round's time
+  Adafruit_LTR390_Flag _stop;                      ///< Asks workers to end
+};
+
+#endif
+
+#endif
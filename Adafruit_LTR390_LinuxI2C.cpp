@@ -0,0 +1,143 @@
+/*!
+ *  @file Adafruit_LTR390_LinuxI2C.cpp
+ *
+ * 	Linux userspace (/dev/i2c-N) bus backend for the LTR390 UV and light
+ * 	sensor
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Adafruit_LTR390_LinuxI2C.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// ioctl() is variadic, so it can't be stored as an ioctl_fn directly
+static int linux_ioctl(int fd, unsigned long request, void *arg) {
+  return ioctl(fd, request, arg);
+}
+
+/*!
+ *    @brief  Instantiates a new Linux I2C backend
+ *    @param  fn Optional replacement for ioctl(), for testing against a fake
+ *            bus. Defaults to the real ioctl()
+ */
+Adafruit_LTR390_LinuxI2C::Adafruit_LTR390_LinuxI2C(ioctl_fn fn)
+    : _ioctl(fn ? fn : linux_ioctl), _fd(-1), _ownsFd(false), _addr(0) {}
+
+/*!
+ *    @brief  Closes the bus if we opened it
+ */
+Adafruit_LTR390_LinuxI2C::~Adafruit_LTR390_LinuxI2C() { end(); }
+
+/*!
+ *  @brief  Open an i2c-dev bus
+ *  @param  path The bus device, e.g. "/dev/i2c-1"
+ *  @param  addr The 7-bit address of the sensor
+ *  @returns True if the bus could be opened
+ */
+bool Adafruit_LTR390_LinuxI2C::begin(const char *path, uint8_t addr) {
+  end();
+  int fd = open(path, O_RDWR);
+  if (fd < 0) {
+    return false;
+  }
+  _fd = fd;
+  _ownsFd = true;
+  _addr = addr;
+  return true;
+}
+
+/*!
+ *  @brief  Use a bus that is already open. It is not closed by end()
+ *  @param  fd An open i2c-dev file descriptor (or anything the fake ioctl
+ *          understands)
+ *  @param  addr The 7-bit address of the sensor
+ *  @returns True
+ */
+bool Adafruit_LTR390_LinuxI2C::begin(int fd, uint8_t addr) {
+  end();
+  _fd = fd;
+  _ownsFd = false;
+  _addr = addr;
+  return true;
+}
+
+/*!
+ *  @brief  Release the bus
+ */
+void Adafruit_LTR390_LinuxI2C::end(void) {
+  if (_ownsFd && (_fd >= 0)) {
+    close(_fd);
+  }
+  _fd = -1;
+  _ownsFd = false;
+}
+
+/*!
+ *  @brief  Read registers with one combined write-then-read transfer
+ *  @param  reg The first register to read
+ *  @param  buffer Where to put the data
+ *  @param  len How many bytes to read
+ *  @returns True if the transfer was acked
+ */
+bool Adafruit_LTR390_LinuxI2C::read(uint8_t reg, uint8_t *buffer,
+                                    size_t len) {
+  struct i2c_msg msgs[2];
+  msgs[0].addr = _addr;
+  msgs[0].flags = 0;
+  msgs[0].len = 1;
+  msgs[0].buf = &reg;
+  msgs[1].addr = _addr;
+  msgs[1].flags = I2C_M_RD;
+  msgs[1].len = len;
+  msgs[1].buf = buffer;
+
+  struct i2c_rdwr_ioctl_data xfer;
+  xfer.msgs = msgs;
+  xfer.nmsgs = 2;
+
+  return (_fd >= 0) && (_ioctl(_fd, I2C_RDWR, &xfer) == 2);
+}
+
+/*!
+ *  @brief  Write registers with one transfer
+ *  @param  reg The first register to write
+ *  @param  buffer The data
+ *  @param  len How many bytes to write, at most LTR390_LINUX_MAX_WRITE
+ *  @returns True if the transfer was acked
+ */
+bool Adafruit_LTR390_LinuxI2C::write(uint8_t reg, const uint8_t *buffer,
+                                     size_t len) {
+  if (len > LTR390_LINUX_MAX_WRITE) {
+    return false;
+  }
+
+  uint8_t out[LTR390_LINUX_MAX_WRITE + 1];
+  out[0] = reg;
+  memcpy(out + 1, buffer, len);
+
+  struct i2c_msg msg;
+  msg.addr = _addr;
+  msg.flags = 0;
+  msg.len = len + 1;
+  msg.buf = out;
+
+  struct i2c_rdwr_ioctl_data xfer;
+  xfer.msgs = &msg;
+  xfer.nmsgs = 1;
+
+  return (_fd >= 0) && (_ioctl(_fd, I2C_RDWR, &xfer) == 1);
+}
+
+#endif
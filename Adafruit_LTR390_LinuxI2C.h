@@ -0,0 +1,59 @@
+/*!
+ *  @file Adafruit_LTR390_LinuxI2C.h
+ *
+ * 	Linux userspace (/dev/i2c-N) bus backend for the LTR390 UV and light
+ * 	sensor
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_LINUXI2C_H
+#define _ADAFRUIT_LTR390_LINUXI2C_H
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LTR390_LINUX_MAX_WRITE 16 ///< Largest register write, in bytes
+
+/*!
+ *    @brief  Talks to an LTR390 through the Linux i2c-dev interface. Every
+ *            register read is one I2C_RDWR ioctl holding a write (register
+ *            address) and a read message joined by a repeated start, and
+ *            every register write is one I2C_RDWR ioctl, so each access is a
+ *            single syscall.
+ */
+class Adafruit_LTR390_LinuxI2C {
+public:
+  /*!    @brief  Signature of ioctl(), so tests can swap in a fake bus  */
+  typedef int (*ioctl_fn)(int fd, unsigned long request, void *arg);
+
+  Adafruit_LTR390_LinuxI2C(ioctl_fn fn = NULL);
+  ~Adafruit_LTR390_LinuxI2C();
+
+  bool begin(const char *path = "/dev/i2c-1", uint8_t addr = 0x53);
+  bool begin(int fd, uint8_t addr);
+  void end(void);
+
+  bool read(uint8_t reg, uint8_t *buffer, size_t len);
+  bool write(uint8_t reg, const uint8_t *buffer, size_t len);
+
+private:
+  ioctl_fn _ioctl; ///< ioctl() or a test double
+  int _fd;         ///< Open i2c-dev file descriptor, or -1
+  bool _ownsFd;    ///< True if end() should close _fd
+  uint8_t _addr;   ///< 7-bit device address
+};
+
+#endif
+
+#endif
@@ -0,0 +1,281 @@
+/*!
+ *  @file Adafruit_LTR390_Mux.cpp
+ *
+ * 	Several LTR390 UV and light sensors behind a TCA9548A I2C multiplexer
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#include "Adafruit_LTR390_Mux.h"
+
+/*!
+ *    @brief  Instantiates a manager with no sensors
+ */
+Adafruit_LTR390_Mux::Adafruit_LTR390_Mux(void)
+    : _count(0), _reverse(false), _clock(NULL), _read(NULL), _write(NULL),
+      _context(NULL), _muxfn(NULL), _muxContext(NULL), _selected(0xFF),
+      _switches(0) {}
+
+/*!
+ *    @brief  Frees the I2C devices made by begin()
+ */
+Adafruit_LTR390_Mux::~Adafruit_LTR390_Mux(void) {
+#if defined(ARDUINO)
+  delete i2c_dev;
+  delete mux_dev;
+#endif
+}
+
+#if defined(ARDUINO)
+/*!
+ *    @brief  Setups the manager for a mux and sensors on one I2C bus
+ *    @param  theWire An optional pointer to an I2C interface
+ *    @param  muxAddr Address of the mux, 0x70 to 0x77
+ *    @return True if the mux answered
+ */
+bool Adafruit_LTR390_Mux::begin(TwoWire *theWire, uint8_t muxAddr) {
+  delete i2c_dev;
+  delete mux_dev;
+  i2c_dev = new Adafruit_I2CDevice(LTR390_I2CADDR_DEFAULT, theWire);
+  mux_dev = new Adafruit_I2CDevice(muxAddr, theWire);
+
+  // the sensors only answer once their channel is selected
+  if (!mux_dev->begin() || !i2c_dev->begin(false)) {
+    return false;
+  }
+
+  return begin(i2cRead, i2cWrite, i2c_dev, i2cWrite, mux_dev);
+}
+#endif
+
+/*!
+ *    @brief  Setups the manager on any bus, through register access functions
+ *    @param  readfn Reads n bytes starting at a sensor register
+ *    @param  writefn Writes n bytes starting at a sensor register
+ *    @param  context Passed through to readfn and writefn
+ *    @param  muxfn Writes to the mux. Called with the channel mask as the
+ *            register and no data
+ *    @param  muxContext Passed through to muxfn
+ *    @return True if the mux accepted a write
+ */
+bool Adafruit_LTR390_Mux::begin(ltr390_read_fn readfn, ltr390_write_fn writefn,
+                                void *context, ltr390_write_fn muxfn,
+                                void *muxContext) {
+  _read = readfn;
+  _write = writefn;
+  _context = context;
+  _muxfn = muxfn;
+  _muxContext = muxContext;
+  _count = 0;
+  _reverse = false;
+  return deselect();
+}
+
+/*!
+ *  @brief  Add the sensor on one mux channel and run its begin()
+ *  @param  channel The mux channel, 0 to 7
+ *  @returns Index of the sensor for sensor() and sampleRound(), or -1 if the
+ *  channel is taken, out of range, the manager already has
+ *  LTR390_MUX_SENSORS sensors, or the sensor did not begin
+ */
+int8_t Adafruit_LTR390_Mux::addSensor(uint8_t channel) {
+  if ((channel >= LTR390_MUX_CHANNELS) || (_count >= LTR390_MUX_SENSORS)) {
+    return -1;
+  }
+  for (uint8_t i = 0; i < _count; i++) {
+    if (_links[i].channel == channel) {
+      return -1;
+    }
+  }
+
+  uint8_t index = _count;
+  _links[index].mux = this;
+  _links[index].channel = channel;
+  _sensors[index].setClock(_clock);
+#if defined(ARDUINO)
+  // so reset() recovers the bus after the soft reset's missing ACK
+  _sensors[index].setBusDevice(i2c_dev);
+#endif
+  if (!_sensors[index].begin(channelRead, channelWrite, &_links[index])) {
+    return -1;
+  }
+
+  // keep _order sorted by channel
+  uint8_t pos = _count;
+  while ((pos > 0) && (_links[_order[pos - 1]].channel > channel)) {
+    _order[pos] = _order[pos - 1];
+    pos--;
+  }
+  _order[pos] = index;
+  _count++;
+  return index;
+}
+
+/*!
+ *  @brief  Replace the time source of every sensor, those already added and
+ *  those added later
+ *  @param  clock The new time source, or NULL for the default. Must outlive
+ *  the manager
+ */
+void Adafruit_LTR390_Mux::setClock(const ltr390_clock_t *clock) {
+  _clock = clock;
+  for (uint8_t i = 0; i < _count; i++) {
+    _sensors[i].setClock(clock);
+  }
+}
+
+/*!
+ *  @brief  Get the number of sensors added
+ *  @returns Sensors, indexed from 0
+ */
+uint8_t Adafruit_LTR390_Mux::sensors(void) { return _count; }
+
+/*!
+ *  @brief  Get the mux channel of a sensor
+ *  @param  index The sensor, as returned by addSensor()
+ *  @returns The channel
+ */
+uint8_t Adafruit_LTR390_Mux::channel(uint8_t index) {
+  return _links[index].channel;
+}
+
+/*!
+ *  @brief  Get a sensor's driver, for configuration and single reads. Its
+ *  channel is selected automatically
+ *  @param  index The sensor, as returned by addSensor()
+ *  @returns The driver, or NULL if index is out of range
+ */
+Adafruit_LTR390 *Adafruit_LTR390_Mux::sensor(uint8_t index) {
+  return (index < _count) ? &_sensors[index] : NULL;
+}
+
+/*!
+ *  @brief  One sampling round: a readNewData() on every sensor, visiting
+ *  the channels in ascending order, then descending in the next round, so
+ *  a round of N sensors costs N - 1 mux switches instead of N
+ *  @param  samples Array indexed like the sensors, new readings go here
+ *  @returns Bit mask of the sensors that had a new reading
+ */
+uint8_t Adafruit_LTR390_Mux::sampleRound(ltr390_sample_t *samples) {
+  uint8_t fresh = 0;
+  for (uint8_t i = 0; i < _count; i++) {
+    uint8_t index = _order[_reverse ? _count - 1 - i : i];
+    if (_sensors[index].readNewData(&samples[index])) {
+      fresh |= 1 << index;
+    }
+  }
+  _reverse = !_reverse;
+  return fresh;
+}
+
+/*!
+ *  @brief  Route the bus to one channel, if it isn't already
+ *  @param  channel The mux channel, 0 to 7
+ *  @returns True if the channel is selected
+ */
+bool Adafruit_LTR390_Mux::select(uint8_t channel) {
+  if (channel == _selected) {
+    return true;
+  }
+  _switches++;
+  uint8_t none = 0;
+  if (!_muxfn(_muxContext, 1 << channel, &none, 0)) {
+    _selected = 0xFF; // the mux may or may not have switched
+    return false;
+  }
+  _selected = channel;
+  return true;
+}
+
+/*!
+ *  @brief  Disconnect every channel, e.g. to use other devices that clash
+ *  with the sensor address
+ *  @returns True if the mux accepted the write
+ */
+bool Adafruit_LTR390_Mux::deselect(void) {
+  _switches++;
+  uint8_t none = 0;
+  _selected = 0xFF;
+  return _muxfn(_muxContext, 0, &none, 0);
+}
+
+/*!
+ *  @brief  Get the number of mux control writes
+ *  @returns Writes since begin() or resetSwitches()
+ */
+uint32_t Adafruit_LTR390_Mux::switches(void) { return _switches; }
+
+/*!
+ *  @brief  Zero the mux control write counter
+ */
+void Adafruit_LTR390_Mux::resetSwitches(void) { _switches = 0; }
+
+/*!
+ *  @brief  Transport read for a sensor, selects its channel first
+ *  @param  context The sensor's link_t
+ *  @param  reg The first register
+ *  @param  buffer Where to put the data
+ *  @param  len How many bytes to read
+ *  @returns True if the channel select and the read succeeded
+ */
+bool Adafruit_LTR390_Mux::channelRead(void *context, uint8_t reg,
+                                      uint8_t *buffer, size_t len) {
+  link_t *link = (link_t *)context;
+  Adafruit_LTR390_Mux *mux = link->mux;
+  return mux->select(link->channel) &&
+         mux->_read(mux->_context, reg, buffer, len);
+}
+
+/*!
+ *  @brief  Transport write for a sensor, selects its channel first
+ *  @param  context The sensor's link_t
+ *  @param  reg The first register
+ *  @param  buffer The data
+ *  @param  len How many bytes to write
+ *  @returns True if the channel select and the write succeeded
+ */
+bool Adafruit_LTR390_Mux::channelWrite(void *context, uint8_t reg,
+                                       const uint8_t *buffer, size_t len) {
+  link_t *link = (link_t *)context;
+  Adafruit_LTR390_Mux *mux = link->mux;
+  return mux->select(link->channel) &&
+         mux->_write(mux->_context, reg, buffer, len);
+}
+
+#if defined(ARDUINO)
+/*!
+ *  @brief  Transport read for the built-in Adafruit_I2CDevice backend
+ *  @param  context The Adafruit_I2CDevice
+ *  @param  reg The first register
+ *  @param  buffer Where to put the data
+ *  @param  len How many bytes to read
+ *  @returns True if the bus read succeeded
+ */
+bool Adafruit_LTR390_Mux::i2cRead(void *context, uint8_t reg, uint8_t *buffer,
+                                  size_t len) {
+  Adafruit_I2CDevice *dev = (Adafruit_I2CDevice *)context;
+  return dev->write_then_read(&reg, 1, buffer, len);
+}
+
+/*!
+ *  @brief  Transport write for the built-in Adafruit_I2CDevice backend
+ *  @param  context The Adafruit_I2CDevice
+ *  @param  reg The first register, or the channel mask for the mux
+ *  @param  buffer The data
+ *  @param  len How many bytes to write
+ *  @returns True if the bus write succeeded
+ */
+bool Adafruit_LTR390_Mux::i2cWrite(void *context, uint8_t reg,
+                                   const uint8_t *buffer, size_t len) {
+  Adafruit_I2CDevice *dev = (Adafruit_I2CDevice *)context;
+  return dev->write(buffer, len, true, &reg, 1);
+}
+#endif
@@ -0,0 +1,132 @@
+/*!
+ *  @file Adafruit_LTR390_Mux.h
+ *
+ * 	Several LTR390 UV and light sensors behind a TCA9548A I2C multiplexer
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_MUX_H
+#define _ADAFRUIT_LTR390_MUX_H
+
+#include "Adafruit_LTR390.h"
+
+#define LTR390_MUX_ADDR_DEFAULT 0x70 ///< TCA9548A address with A0-A2 low
+#define LTR390_MUX_CHANNELS 8        ///< Downstream channels on a TCA9548A
+
+// Each driver is a few hundred bytes, too many for 8 in the 2KB of an Uno
+#ifndef LTR390_MUX_SENSORS
+#if defined(__AVR__)
+#define LTR390_MUX_SENSORS 4 ///< Most sensors on one manager
+#else
+#define LTR390_MUX_SENSORS 8 ///< Most sensors on one manager
+#endif
+#endif
+
+/*!
+ *    @brief  Owns one Adafruit_LTR390 per mux channel, up to
+ *            LTR390_MUX_SENSORS of them. Every driver talks through the
+ *            manager, which only writes the mux control register when a
+ *            transaction is for a different channel than the one selected,
+ *            so all calls on one sensor share one switch. sampleRound()
+ *            samples every sensor in serpentine order, alternating direction
+ *            so each round starts on the channel the last one ended on.
+ */
+class Adafruit_LTR390_Mux {
+public:
+  Adafruit_LTR390_Mux();
+  ~Adafruit_LTR390_Mux();
+
+#if defined(ARDUINO)
+  bool begin(TwoWire *theWire = &Wire,
+             uint8_t muxAddr = LTR390_MUX_ADDR_DEFAULT);
+#endif
+  bool begin(ltr390_read_fn readfn, ltr390_write_fn writefn, void *context,
+             ltr390_write_fn muxfn, void *muxContext);
+
+  /*!
+   *  @brief  Setups the manager on custom transports, e.g. two
+   *          Adafruit_LTR390_LinuxI2C, one at 0x53 and one at the mux address
+   *  @param  bus Transport to the sensors, read() and write() as for
+   *          Adafruit_LTR390::beginTransport()
+   *  @param  mux Transport to the mux. The channel mask is sent as the
+   *          register byte of a write() with no data
+   *  @return True on success
+   */
+  template <class T, class M> bool beginTransport(T *bus, M *mux) {
+    return begin(transportRead<T>, transportWrite<T>, bus, transportWrite<M>,
+                 mux);
+  }
+
+  void setClock(const ltr390_clock_t *clock);
+
+  int8_t addSensor(uint8_t channel);
+  uint8_t sensors(void);
+  uint8_t channel(uint8_t index);
+  Adafruit_LTR390 *sensor(uint8_t index);
+
+  uint8_t sampleRound(ltr390_sample_t *samples);
+
+  bool select(uint8_t channel);
+  bool deselect(void);
+  uint32_t switches(void);
+  void resetSwitches(void);
+
+private:
+  template <class T>
+  static bool transportRead(void *context, uint8_t reg, uint8_t *buffer,
+                            size_t len) {
+    return static_cast<T *>(context)->read(reg, buffer, len);
+  }
+  template <class T>
+  static bool transportWrite(void *context, uint8_t reg,
+                             const uint8_t *buffer, size_t len) {
+    return static_cast<T *>(context)->write(reg, buffer, len);
+  }
+
+  static bool channelRead(void *context, uint8_t reg, uint8_t *buffer,
+                          size_t len);
+  static bool channelWrite(void *context, uint8_t reg, const uint8_t *buffer,
+                           size_t len);
+
+  /*!    @brief  What each driver gets as its transport context  */
+  typedef struct {
+    Adafruit_LTR390_Mux *mux; ///< The manager
+    uint8_t channel;          ///< Mux channel of the sensor
+  } link_t;
+
+  Adafruit_LTR390 _sensors[LTR390_MUX_SENSORS]; ///< The drivers
+  link_t _links[LTR390_MUX_SENSORS];            ///< Driver transport contexts
+  uint8_t _order[LTR390_MUX_SENSORS]; ///< Sensor indexes sorted by channel
+  uint8_t _count;                     ///< Sensors added
+  bool _reverse;                      ///< Direction of the next round
+  const ltr390_clock_t *_clock;       ///< Time source for new sensors
+
+  ltr390_read_fn _read;   ///< Sensor bus read
+  ltr390_write_fn _write; ///< Sensor bus write
+  void *_context;         ///< Sensor bus transport
+  ltr390_write_fn _muxfn; ///< Mux control write
+  void *_muxContext;      ///< Mux transport
+  uint8_t _selected;      ///< Selected channel, 0xFF if unknown or none
+  uint32_t _switches;     ///< Mux control writes
+
+#if defined(ARDUINO)
+  static bool i2cRead(void *context, uint8_t reg, uint8_t *buffer,
+                      size_t len);
+  static bool i2cWrite(void *context, uint8_t reg, const uint8_t *buffer,
+                       size_t len);
+
+  Adafruit_I2CDevice *i2c_dev = NULL; ///< The sensors
+  Adafruit_I2CDevice *mux_dev = NULL; ///< The mux
+#endif
+};
+
+#endif
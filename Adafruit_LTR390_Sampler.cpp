@@ -0,0 +1,185 @@
+/*!
+ *  @file Adafruit_LTR390_Sampler.cpp
+ *
+ * 	Background acquisition for the LTR390 UV and light sensor: a task or
+ * 	thread that owns the sensor and queues every new reading
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#include "Adafruit_LTR390_Sampler.h"
+
+#if LTR390_THREADS
+
+/*!
+ *    @brief  Instantiates a sampler for a sensor that has already begun
+ *    @param  ltr The sensor, configured as wanted
+ *    @param  buffer Queue storage, must outlive the sampler
+ *    @param  capacity Records buffer can hold
+ *    @param  policy What to drop when the queue is full
+ */
+Adafruit_LTR390_Sampler::Adafruit_LTR390_Sampler(Adafruit_LTR390 *ltr,
+                                                 ltr390_record_t *buffer,
+                                                 size_t capacity,
+                                                 ltr390_overflow_t policy)
+    : _ltr(ltr), _buffer(buffer), _capacity(capacity), _policy(policy),
+      _head(0), _count(0), _dropped(0), _errors(0), _pollMs(5),
+      _mode(LTR390_MODE_ALS) {}
+
+/*!
+ *    @brief  Stops the task
+ */
+Adafruit_LTR390_Sampler::~Adafruit_LTR390_Sampler(void) { stop(); }
+
+/*!
+ *  @brief  Start sampling in the background
+ *  @param  pollMs Longest time between checks for new data. Use the
+ *  measurement rate, or less, if nothing calls notify()
+ *  @param  priority Task priority, FreeRTOS only
+ *  @param  stack Task stack in bytes, FreeRTOS only
+ *  @returns True if the task started
+ */
+bool Adafruit_LTR390_Sampler::start(uint32_t pollMs, uint8_t priority,
+                                    uint32_t stack) {
+  if (_thread.running() || (_capacity == 0)) {
+    return false;
+  }
+  _pollMs = pollMs;
+  _mode = _ltr->getMode(); // only the task touches the sensor from here on
+  _stop.set(false);
+  return _thread.start(task, this, "ltr390", stack, priority);
+}
+
+/*!
+ *  @brief  Stop sampling and wait for the task to finish. Queued readings
+ *  stay until popped
+ */
+void Adafruit_LTR390_Sampler::stop(void) {
+  if (!_thread.running()) {
+    return;
+  }
+  _stop.set(true);
+  _wake.signal();
+  _thread.join();
+}
+
+/*!
+ *  @brief  Check if the task is running
+ *  @returns True between start() and stop()
+ */
+bool Adafruit_LTR390_Sampler::running(void) { return _thread.running(); }
+
+/*!
+ *  @brief  Wake the task to check for data now, e.g. from a data-ready
+ *  interrupt routed through configInterrupt()
+ */
+void Adafruit_LTR390_Sampler::notify(void) { _wake.signal(); }
+
+/*!
+ *  @brief  notify() for use inside an interrupt handler
+ */
+void Adafruit_LTR390_Sampler::notifyFromISR(void) { _wake.signalFromISR(); }
+
+/*!
+ *  @brief  Take the oldest queued reading. Never touches the bus
+ *  @param  record Where to put the reading
+ *  @returns True if there was one
+ */
+bool Adafruit_LTR390_Sampler::pop(ltr390_record_t *record) {
+  _lock.lock();
+  bool found = _count > 0;
+  if (found) {
+    *record = _buffer[_head];
+    _head = (_head + 1) % _capacity;
+    _count--;
+  }
+  _lock.unlock();
+  return found;
+}
+
+/*!
+ *  @brief  Get the number of queued readings
+ *  @returns Readings pop() can return right now
+ */
+size_t Adafruit_LTR390_Sampler::available(void) {
+  _lock.lock();
+  size_t count = _count;
+  _lock.unlock();
+  return count;
+}
+
+/*!
+ *  @brief  Get the number of readings lost because the queue was full
+ *  @returns Dropped readings since the sampler was made
+ */
+uint32_t Adafruit_LTR390_Sampler::dropped(void) {
+  _lock.lock();
+  uint32_t dropped = _dropped;
+  _lock.unlock();
+  return dropped;
+}
+
+/*!
+ *  @brief  Get the number of checks that failed after all retries
+ *  @returns poll() calls that returned LTR390_BUS_ERROR
+ */
+uint32_t Adafruit_LTR390_Sampler::errors(void) {
+  _lock.lock();
+  uint32_t errors = _errors;
+  _lock.unlock();
+  return errors;
+}
+
+/*!
+ *  @brief  The task: check for data, queue it, sleep until the next check
+ *  @param  self The sampler
+ */
+void Adafruit_LTR390_Sampler::task(void *self) {
+  Adafruit_LTR390_Sampler *sampler = (Adafruit_LTR390_Sampler *)self;
+  Adafruit_LTR390 *ltr = sampler->_ltr;
+
+  while (!sampler->_stop.get()) {
+    ltr390_record_t record;
+    ltr390_status_t status = ltr->poll(&record.sample);
+    if (status == LTR390_OK) {
+      record.mode = sampler->_mode;
+      record.micros = ltr->clockMicros();
+      sampler->push(&record);
+    } else if (status == LTR390_BUS_ERROR) {
+      sampler->_lock.lock();
+      sampler->_errors++;
+      sampler->_lock.unlock();
+    }
+    sampler->_wake.wait(sampler->_pollMs);
+  }
+}
+
+/*!
+ *  @brief  Queue a reading, applying the overflow policy
+ *  @param  record The reading
+ */
+void Adafruit_LTR390_Sampler::push(const ltr390_record_t *record) {
+  _lock.lock();
+  if (_count == _capacity) {
+    _dropped++;
+    if (_policy == LTR390_OVERFLOW_DROP_NEWEST) {
+      _lock.unlock();
+      return;
+    }
+    _head = (_head + 1) % _capacity;
+    _count--;
+  }
+  _buffer[(_head + _count) % _capacity] = *record;
+  _count++;
+  _lock.unlock();
+}
+
+#endif
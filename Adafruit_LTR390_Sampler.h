@@ -0,0 +1,90 @@
+/*!
+ *  @file Adafruit_LTR390_Sampler.h
+ *
+ * 	Background acquisition for the LTR390 UV and light sensor: a task or
+ * 	thread that owns the sensor and queues every new reading
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_SAMPLER_H
+#define _ADAFRUIT_LTR390_SAMPLER_H
+
+#include "Adafruit_LTR390_Thread.h"
+
+#if LTR390_THREADS
+
+/*!    @brief  What to do with a new reading when the queue is full  */
+typedef enum {
+  LTR390_OVERFLOW_DROP_OLDEST, ///< Make room by dropping the oldest reading
+  LTR390_OVERFLOW_DROP_NEWEST, ///< Drop the new reading
+} ltr390_overflow_t;
+
+/*!    @brief  One queued reading  */
+typedef struct {
+  ltr390_sample_t sample; ///< The reading and its flags
+  ltr390_mode_t mode;     ///< Channel it came from
+  uint32_t micros;        ///< Driver clockMicros() when it was read
+} ltr390_record_t;
+
+/*!
+ *    @brief  Runs the sensor from its own FreeRTOS task or std::thread
+ *            (host), see LTR390_THREADS. The task checks for new data with
+ *            one poll() burst per wake-up and pushes each new reading into
+ *            a bounded queue, which any number of other tasks drain with
+ *            pop(). Wake-ups come every pollMs, or earlier from notify(),
+ *            e.g. called from the sensor's interrupt pin. Once started,
+ *            only the sampler may call into the driver, apart from
+ *            getSnapshot().
+ */
+class Adafruit_LTR390_Sampler {
+public:
+  Adafruit_LTR390_Sampler(Adafruit_LTR390 *ltr, ltr390_record_t *buffer,
+                          size_t capacity,
+                          ltr390_overflow_t policy =
+                              LTR390_OVERFLOW_DROP_OLDEST);
+  ~Adafruit_LTR390_Sampler();
+
+  bool start(uint32_t pollMs = 5, uint8_t priority = 1,
+             uint32_t stack = 4096);
+  void stop(void);
+  bool running(void);
+  void notify(void);
+  void notifyFromISR(void);
+
+  bool pop(ltr390_record_t *record);
+  size_t available(void);
+  uint32_t dropped(void);
+  uint32_t errors(void);
+
+private:
+  static void task(void *self);
+  void push(const ltr390_record_t *record);
+
+  Adafruit_LTR390 *_ltr;          ///< The sensor
+  ltr390_record_t *_buffer;       ///< Queue storage
+  size_t _capacity;               ///< Queue size in records
+  ltr390_overflow_t _policy;      ///< What to drop when full
+  size_t _head;                   ///< Next record to pop
+  size_t _count;                  ///< Records queued
+  uint32_t _dropped;              ///< Readings lost to a full queue
+  uint32_t _errors;               ///< poll() calls that gave LTR390_BUS_ERROR
+  uint32_t _pollMs;               ///< Longest sleep between checks
+  ltr390_mode_t _mode;            ///< Sensor mode when started
+  Adafruit_LTR390_Flag _stop;     ///< Asks the task to finish
+  Adafruit_LTR390_Mutex _lock;    ///< Guards the queue and counters
+  Adafruit_LTR390_Event _wake;    ///< Wakes the task early
+  Adafruit_LTR390_Thread _thread; ///< The task
+};
+
+#endif
+
+#endif
@@ -0,0 +1,425 @@
+/*!
+ *  @file Adafruit_LTR390_Sim.cpp
+ *
+ * 	Register and timing model of the LTR390 UV and light sensor, for running
+ * 	the driver without hardware
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Adafruit_LTR390_Sim.h"
+
+// Power-on register values, from the datasheet
+static const uint8_t reset_regs[LTR390_SIM_REGS] = {
+    0x00, 0x00, 0x00, 0x00, 0x22, 0x01, 0xB2, 0x20, // 0x00 - 0x07
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x08 - 0x0F
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x10 - 0x17
+    0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 0x18 - 0x1F
+    0x00, 0xFF, 0xFF, 0x0F, 0x00, 0x00, 0x00,       // 0x20 - 0x26
+};
+
+// Gain multipliers indexed by ltr390_gain_t
+static const uint8_t gain_mult[] = {1, 3, 6, 9, 18};
+
+static bool writable(uint8_t reg) {
+  return (reg == LTR390_MAIN_CTRL) || (reg == LTR390_MEAS_RATE) ||
+         (reg == LTR390_GAIN) || (reg == LTR390_INT_CFG) ||
+         (reg == LTR390_INT_PST) ||
+         ((reg >= LTR390_THRESH_UP) && (reg < LTR390_THRESH_LOW + 3));
+}
+
+static uint32_t get20(const uint8_t *p) {
+  return ((uint32_t)(p[2] & 0x0F) << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+static void put20(uint8_t *p, uint32_t value) {
+  p[0] = value & 0xFF;
+  p[1] = (value >> 8) & 0xFF;
+  p[2] = (value >> 16) & 0x0F;
+}
+
+static uint32_t sim_millis(void *context) {
+  return ((Adafruit_LTR390_Sim *)context)->micros() / 1000;
+}
+
+static uint32_t sim_micros(void *context) {
+  return ((Adafruit_LTR390_Sim *)context)->micros();
+}
+
+static void sim_delay(void *context, uint32_t ms) {
+  ((Adafruit_LTR390_Sim *)context)->advance(ms * 1000);
+}
+
+/*!
+ *    @brief  Instantiates a powered-up sensor in the dark at virtual time 0
+ */
+Adafruit_LTR390_Sim::Adafruit_LTR390_Sim(void)
+    : _now(0), _trace(NULL), _traceContext(NULL), _als(0), _uvs(0),
+      _failNext(0), _busHz(100000), _stretchNs(0), _stretchSeed(1) {
+  powerCycle();
+  resetCounters();
+}
+
+/*!
+ *  @brief  Simulate a power cycle or brownout: every register goes back to
+ *  its reset value, the sensor goes to standby and MAIN_STATUS reports
+ *  power-on
+ */
+void Adafruit_LTR390_Sim::powerCycle(void) {
+  memcpy(_regs, reset_regs, sizeof(_regs));
+  _converting = false;
+  _persist = 0;
+  _intPin = false;
+  _lastLatch = 0;
+  _conversions = 0;
+}
+
+/*!
+ *  @brief  Use constant light
+ *  @param  als Ambient light, in counts at gain 1 and 20 bit resolution
+ *  @param  uvs UV light, in counts at gain 1 and 20 bit resolution
+ */
+void Adafruit_LTR390_Sim::setLight(uint32_t als, uint32_t uvs) {
+  _trace = NULL;
+  _als = als;
+  _uvs = uvs;
+}
+
+/*!
+ *  @brief  Use a programmable light trace. It is sampled at the middle of
+ *  each conversion
+ *  @param  fn Returns the light at a virtual time, in counts at gain 1 and
+ *          20 bit resolution
+ *  @param  context Passed through to fn
+ */
+void Adafruit_LTR390_Sim::setLightTrace(ltr390_light_fn fn, void *context) {
+  _trace = fn;
+  _traceContext = context;
+}
+
+/*!
+ *  @brief  Set the bus clock used to charge virtual time for transactions
+ *  @param  hz Bus clock, e.g. 100000 or 400000. 0 makes the bus free
+ */
+void Adafruit_LTR390_Sim::setBusClock(uint32_t hz) { _busHz = hz; }
+
+/*!
+ *  @brief  Let the sensor stretch the clock on each transaction, by a random
+ *  time from a seeded generator so runs repeat. Without it every transfer
+ *  of a size takes the same time and the timing has no spread
+ *  @param  maxUs Longest stretch in microseconds, 0 for none
+ *  @param  seed Starts the generator, any value but 0
+ */
+void Adafruit_LTR390_Sim::setClockStretch(uint32_t maxUs, uint32_t seed) {
+  _stretchNs = maxUs * 1000;
+  _stretchSeed = seed ? seed : 1;
+}
+
+/*!
+ *  @brief  NACK the next few transactions, to exercise error handling. A
+ *  NACKed transaction still takes bus time but has no other effect
+ *  @param  count Number of transactions to fail
+ */
+void Adafruit_LTR390_Sim::failNext(uint8_t count) { _failNext = count; }
+
+/*!
+ *  @brief  Move virtual time forward, running any conversions that finish
+ *  @param  us Microseconds to advance
+ */
+void Adafruit_LTR390_Sim::advance(uint32_t us) {
+  run(_now + (uint64_t)us * 1000);
+}
+
+/*!
+ *  @brief  Get the virtual time
+ *  @returns Microseconds since the simulator was created
+ */
+uint64_t Adafruit_LTR390_Sim::micros(void) { return _now / 1000; }
+
+/*!
+ *  @brief  Get a time source that runs on virtual time, for setClock().
+ *  Driver delays advance the simulation instantly instead of sleeping
+ *  @returns A clock bound to this simulator
+ */
+ltr390_clock_t Adafruit_LTR390_Sim::clock(void) {
+  ltr390_clock_t clk = {sim_millis, sim_micros, sim_delay, this};
+  return clk;
+}
+
+/*!
+ *  @brief  Bus read of one or more registers, with auto-increment
+ *  @param  reg The first register
+ *  @param  buffer Where to put the data
+ *  @param  len How many bytes to read
+ *  @returns True, unless failNext() asked for a NACK
+ */
+bool Adafruit_LTR390_Sim::read(uint8_t reg, uint8_t *buffer, size_t len) {
+  // S, addr+W, reg, Sr, addr+R, data..., P
+  busTime(1 + 9 + 9 + 1 + 9 + 9 * len + 1);
+  _transactions++;
+  if (_failNext) {
+    _failNext--;
+    memset(buffer, 0xFF, len);
+    return false;
+  }
+  _bytesRead += len;
+  _bytesWritten += 1; // register address
+
+  bool status_read = false;
+  for (size_t i = 0; i < len; i++) {
+    uint8_t r = reg + i;
+    buffer[i] = (r < LTR390_SIM_REGS) ? _regs[r] : 0;
+    if (r == LTR390_MAIN_STATUS) {
+      status_read = true;
+    }
+  }
+
+  if (status_read) {
+    // power-on, interrupt and data status all clear on read
+    _regs[LTR390_MAIN_STATUS] &= ~0x38;
+    _intPin = false;
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Bus write of one or more registers, with auto-increment
+ *  @param  reg The first register
+ *  @param  buffer The data
+ *  @param  len How many bytes to write
+ *  @returns True, except for a soft reset which is not acked, or when
+ *  failNext() asked for a NACK
+ */
+bool Adafruit_LTR390_Sim::write(uint8_t reg, const uint8_t *buffer,
+                                size_t len) {
+  // S, addr+W, reg, data..., P
+  busTime(1 + 9 + 9 + 9 * len + 1);
+  _transactions++;
+  if (_failNext) {
+    _failNext--;
+    return false;
+  }
+  _bytesWritten += len + 1;
+
+  for (size_t i = 0; i < len; i++) {
+    uint8_t r = reg + i;
+    if ((r >= LTR390_SIM_REGS) || !writable(r)) {
+      continue;
+    }
+
+    if (r == LTR390_MAIN_CTRL) {
+      if (buffer[i] & 0x10) {
+        // soft reset: back to defaults, and the sensor drops the ack
+        memcpy(_regs, reset_regs, sizeof(_regs));
+        _converting = false;
+        _persist = 0;
+        _intPin = false;
+        return false;
+      }
+      bool was_enabled = _regs[r] & 0x02;
+      _regs[r] = buffer[i] & 0x0A;
+      if (!was_enabled && (_regs[r] & 0x02)) {
+        startConversion(_now);
+      } else if (!(_regs[r] & 0x02)) {
+        _converting = false;
+      }
+      continue;
+    }
+    _regs[r] = buffer[i];
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Check the interrupt output
+ *  @returns True while the INT pin is asserted (it is active low on the
+ *  real part)
+ */
+bool Adafruit_LTR390_Sim::interrupt(void) { return _intPin; }
+
+/*!
+ *  @brief  Get when the data registers were last updated
+ *  @returns Virtual time of the last completed conversion, in microseconds
+ */
+uint64_t Adafruit_LTR390_Sim::lastConversion(void) { return _lastLatch / 1000; }
+
+/*!
+ *  @brief  Get how many conversions have completed since power-up
+ *  @returns Conversion count
+ */
+uint32_t Adafruit_LTR390_Sim::conversions(void) { return _conversions; }
+
+/*!
+ *  @brief  Get the time until the data registers next update
+ *  @returns Microseconds until the running conversion finishes, or 0 if the
+ *  sensor is in standby
+ */
+uint32_t Adafruit_LTR390_Sim::nextConversionIn(void) {
+  if (!_converting) {
+    return 0;
+  }
+  uint64_t end = (_convEnd > _now) ? _convEnd : _nextStart;
+  return (end - _now + 999) / 1000;
+}
+
+/*!
+ *  @brief  Get the number of bus transactions since resetCounters()
+ *  @returns Transaction count
+ */
+uint32_t Adafruit_LTR390_Sim::transactions(void) { return _transactions; }
+
+/*!
+ *  @brief  Get the number of data bytes read since resetCounters()
+ *  @returns Byte count
+ */
+uint32_t Adafruit_LTR390_Sim::bytesRead(void) { return _bytesRead; }
+
+/*!
+ *  @brief  Get the number of bytes written since resetCounters()
+ *  @returns Byte count, including register addresses
+ */
+uint32_t Adafruit_LTR390_Sim::bytesWritten(void) { return _bytesWritten; }
+
+/*!
+ *  @brief  Get the bus time used since resetCounters()
+ *  @returns Microseconds of bus occupancy at the configured clock
+ */
+uint64_t Adafruit_LTR390_Sim::busMicros(void) { return _busNs / 1000; }
+
+/*!
+ *  @brief  Zero the bus counters
+ */
+void Adafruit_LTR390_Sim::resetCounters(void) {
+  _transactions = 0;
+  _bytesRead = 0;
+  _bytesWritten = 0;
+  _busNs = 0;
+}
+
+/*!
+ *  @brief  Run conversions up to a point in virtual time
+ *  @param  until_ns The new virtual time
+ */
+void Adafruit_LTR390_Sim::run(uint64_t until_ns) {
+  while (_converting && (_convEnd <= until_ns)) {
+    _now = _convEnd;
+    finishConversion();
+    startConversion(_nextStart);
+  }
+  if (until_ns > _now) {
+    _now = until_ns;
+  }
+}
+
+/*!
+ *  @brief  Start a conversion with the settings in the registers now
+ *  @param  at_ns When the conversion starts
+ */
+void Adafruit_LTR390_Sim::startConversion(uint64_t at_ns) {
+  _convMode = _regs[LTR390_MAIN_CTRL] & 0x08;
+  _convMeasRate = _regs[LTR390_MEAS_RATE];
+  _convGain = _regs[LTR390_GAIN] & 0x07;
+
+  ltr390_resolution_t res = (ltr390_resolution_t)((_convMeasRate >> 4) & 0x07);
+  ltr390_rate_t rate = (ltr390_rate_t)(_convMeasRate & 0x07);
+  uint64_t conv = (uint64_t)Adafruit_LTR390::conversionMicros(res) * 1000;
+  uint64_t period = (uint64_t)Adafruit_LTR390::rateMicros(rate) * 1000;
+
+  _converting = true;
+  _convStart = at_ns;
+  _convEnd = at_ns + conv;
+  _nextStart = at_ns + ((period > conv) ? period : conv);
+}
+
+/*!
+ *  @brief  Latch the result of the running conversion and update the status
+ *  and interrupt state
+ */
+void Adafruit_LTR390_Sim::finishConversion(void) {
+  ltr390_mode_t channel = _convMode ? LTR390_MODE_UVS : LTR390_MODE_ALS;
+  ltr390_resolution_t res = (ltr390_resolution_t)((_convMeasRate >> 4) & 0x07);
+  if (res > LTR390_RESOLUTION_13BIT) {
+    res = LTR390_RESOLUTION_13BIT;
+  }
+  uint8_t gain = _convGain;
+  if (gain > LTR390_GAIN_18) {
+    gain = LTR390_GAIN_18;
+  }
+
+  // counts scale with gain and integration time (the 20 bit conversion is
+  // 400ms, each step down halves it, 13 bit is 12.5ms)
+  uint64_t level = light((_convStart + _convEnd) / 2, channel);
+  uint8_t shift = (res == LTR390_RESOLUTION_13BIT) ? 5 : res;
+  uint64_t counts = (level * gain_mult[gain]) >> shift;
+  uint32_t full = Adafruit_LTR390::fullScale(res);
+  if (counts > full) {
+    counts = full;
+  }
+
+  put20(&_regs[_convMode ? LTR390_UVSDATA : LTR390_ALSDATA], counts);
+  _regs[LTR390_MAIN_STATUS] |= 0x08;
+  _lastLatch = _now;
+  _conversions++;
+
+  // threshold interrupt, only for the channel being measured
+  uint8_t intcfg = _regs[LTR390_INT_CFG];
+  uint8_t source = (intcfg >> 4) & 0x03;
+  bool source_match = ((source == 1) && (channel == LTR390_MODE_ALS)) ||
+                      ((source == 3) && (channel == LTR390_MODE_UVS));
+  if (!(intcfg & 0x04) || !source_match) {
+    _persist = 0;
+    return;
+  }
+
+  uint32_t upper = get20(&_regs[LTR390_THRESH_UP]);
+  uint32_t lower = get20(&_regs[LTR390_THRESH_LOW]);
+  if ((counts > upper) || (counts < lower)) {
+    if (_persist < 0xFF) {
+      _persist++;
+    }
+  } else {
+    _persist = 0;
+  }
+  if (_persist > (_regs[LTR390_INT_PST] >> 4)) {
+    _regs[LTR390_MAIN_STATUS] |= 0x10;
+    _intPin = true;
+  }
+}
+
+/*!
+ *  @brief  Charge virtual time for a transaction on the bus, including any
+ *  clock stretch. Conversions keep running while the bus is busy
+ *  @param  bits Bit times the transaction takes, including start/stop
+ */
+void Adafruit_LTR390_Sim::busTime(size_t bits) {
+  if (_busHz == 0) {
+    return;
+  }
+  uint64_t ns = (uint64_t)bits * 1000000000ULL / _busHz;
+  if (_stretchNs) {
+    // xorshift32
+    _stretchSeed ^= _stretchSeed << 13;
+    _stretchSeed ^= _stretchSeed >> 17;
+    _stretchSeed ^= _stretchSeed << 5;
+    ns += _stretchSeed % (_stretchNs + 1);
+  }
+  _busNs += ns;
+  run(_now + ns);
+}
+
+/*!
+ *  @brief  Get the light level on one channel
+ *  @param  time_ns Virtual time
+ *  @param  channel LTR390_MODE_ALS or LTR390_MODE_UVS
+ *  @returns Counts at gain 1 and 20 bit resolution
+ */
+uint32_t Adafruit_LTR390_Sim::light(uint64_t time_ns, ltr390_mode_t channel) {
+  if (_trace) {
+    return _trace(_traceContext, time_ns / 1000, channel);
+  }
+  return (channel == LTR390_MODE_UVS) ? _uvs : _als;
+}
@@ -0,0 +1,105 @@
+/*!
+ *  @file Adafruit_LTR390_Sim.h
+ *
+ * 	Register and timing model of the LTR390 UV and light sensor, for running
+ * 	the driver without hardware
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_SIM_H
+#define _ADAFRUIT_LTR390_SIM_H
+
+#include "Adafruit_LTR390.h"
+
+#define LTR390_SIM_REGS 0x27 ///< Size of the modelled register file
+
+/*!    @brief  Light seen by one channel at a point in virtual time, in counts
+ *             at gain 1 and 20 bit resolution  */
+typedef uint32_t (*ltr390_light_fn)(void *context, uint64_t time_us,
+                                    ltr390_mode_t channel);
+
+/*!
+ *    @brief  Software LTR390. Models the register file (reset values,
+ *            read-only registers, clear-on-read MAIN_STATUS, soft reset,
+ *            auto-increment), conversions timed from MEAS_RATE against a
+ *            virtual clock, and threshold interrupts with persistence. Each
+ *            bus transaction also advances the clock by its time on the wire,
+ *            plus a seeded random clock stretch if one is set.
+ *            Plug it into the driver with beginTransport().
+ */
+class Adafruit_LTR390_Sim {
+public:
+  Adafruit_LTR390_Sim();
+
+  void powerCycle(void);
+  void setLight(uint32_t als, uint32_t uvs);
+  void setLightTrace(ltr390_light_fn fn, void *context);
+  void setBusClock(uint32_t hz);
+  void setClockStretch(uint32_t maxUs, uint32_t seed = 1);
+  void failNext(uint8_t count);
+
+  void advance(uint32_t us);
+  uint64_t micros(void);
+  ltr390_clock_t clock(void);
+
+  bool read(uint8_t reg, uint8_t *buffer, size_t len);
+  bool write(uint8_t reg, const uint8_t *buffer, size_t len);
+
+  bool interrupt(void);
+  uint64_t lastConversion(void);
+  uint32_t conversions(void);
+  uint32_t nextConversionIn(void);
+
+  uint32_t transactions(void);
+  uint32_t bytesRead(void);
+  uint32_t bytesWritten(void);
+  uint64_t busMicros(void);
+  void resetCounters(void);
+
+private:
+  void run(uint64_t until_ns);
+  void startConversion(uint64_t at_ns);
+  void finishConversion(void);
+  void busTime(size_t bits);
+  uint32_t light(uint64_t time_ns, ltr390_mode_t channel);
+
+  uint8_t _regs[LTR390_SIM_REGS]; ///< Register file
+
+  uint64_t _now;         ///< Virtual time, ns
+  uint64_t _convStart;   ///< Start of the running conversion, ns
+  uint64_t _convEnd;     ///< End of the running conversion, ns
+  uint64_t _nextStart;   ///< Start of the next conversion, ns
+  uint64_t _lastLatch;   ///< When data was last latched, ns
+  bool _converting;      ///< True while enabled
+  uint8_t _convMode;     ///< MAIN_CTRL mode bit at conversion start
+  uint8_t _convMeasRate; ///< MEAS_RATE at conversion start
+  uint8_t _convGain;     ///< GAIN at conversion start
+  uint8_t _persist;      ///< Consecutive out-of-threshold conversions
+  bool _intPin;          ///< Interrupt output asserted
+  uint32_t _conversions; ///< Conversions completed
+
+  ltr390_light_fn _trace; ///< Light source, or NULL for constant light
+  void *_traceContext;    ///< Passed to _trace
+  uint32_t _als;          ///< Constant ALS light, gain 1 / 20 bit counts
+  uint32_t _uvs;          ///< Constant UVS light, gain 1 / 20 bit counts
+
+  uint8_t _failNext;      ///< Transactions left to NACK
+  uint32_t _busHz;        ///< Bus clock for transaction timing, 0 for none
+  uint32_t _transactions; ///< Bus transactions seen
+  uint32_t _bytesRead;    ///< Data bytes read
+  uint32_t _bytesWritten; ///< Bytes written, including register addresses
+  uint64_t _busNs;        ///< Time spent on the bus, ns
+  uint32_t _stretchNs;    ///< Longest clock stretch per transaction, ns
+  uint32_t _stretchSeed;  ///< xorshift32 state drawing the stretches
+};
+
+#endif
@@ -0,0 +1,258 @@
+/*!
+ *  @file Adafruit_LTR390_Thread.h
+ *
+ * 	Minimal thread, mutex and event wrappers for the LTR390 background
+ * 	samplers: FreeRTOS on ESP32, the Adafruit nRF52 core or any core
+ * 	built with LTR390_FREERTOS, the C++ standard library on a host.
+ * 	LTR390_THREADS is 0 on every other platform and the samplers are left
+ * 	out
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_THREAD_H
+#define _ADAFRUIT_LTR390_THREAD_H
+
+#include "Adafruit_LTR390.h"
+
+// FreeRTOS always runs on ESP32 and the Adafruit nRF52 core. On cores where
+// it is optional, e.g. RP2040 or SAMD with a FreeRTOS library, define
+// LTR390_FREERTOS for the whole build (-D, build_flags) to use it
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#define LTR390_THREADS 1 ///< FreeRTOS tasks
+#define LTR390_RTOS 1    ///< Built on FreeRTOS
+#elif defined(ARDUINO_NRF52_ADAFRUIT) || defined(LTR390_FREERTOS)
+#include <FreeRTOS.h>
+#include <semphr.h>
+#include <task.h>
+#define LTR390_THREADS 1 ///< FreeRTOS tasks
+#define LTR390_RTOS 1    ///< Built on FreeRTOS
+#elif !defined(ARDUINO)
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#define LTR390_THREADS 1 ///< std::thread
+#define LTR390_RTOS 0    ///< Built on the C++ standard library
+#else
+#define LTR390_THREADS 0 ///< No thread support on this platform
+#define LTR390_RTOS 0    ///< No thread support on this platform
+#endif
+
+#if LTR390_THREADS
+
+/*!
+ *    @brief  Non-recursive mutex
+ */
+class Adafruit_LTR390_Mutex {
+public:
+#if LTR390_RTOS
+  Adafruit_LTR390_Mutex() { _mutex = xSemaphoreCreateMutex(); }
+  ~Adafruit_LTR390_Mutex() { vSemaphoreDelete(_mutex); }
+  /*!  @brief  Wait for and take the mutex  */
+  void lock(void) { xSemaphoreTake(_mutex, portMAX_DELAY); }
+  /*!  @brief  Release the mutex  */
+  void unlock(void) { xSemaphoreGive(_mutex); }
+
+private:
+  SemaphoreHandle_t _mutex; ///< The FreeRTOS mutex
+#else
+  /*!  @brief  Wait for and take the mutex  */
+  void lock(void) { _mutex.lock(); }
+  /*!  @brief  Release the mutex  */
+  void unlock(void) { _mutex.unlock(); }
+
+private:
+  std::mutex _mutex; ///< The std::mutex
+#endif
+};
+
+/*!
+ *    @brief  Auto-reset event: one waiter sleeps until signalled or a
+ *            timeout. A signal with nobody waiting is kept for the next wait
+ */
+class Adafruit_LTR390_Event {
+public:
+#if LTR390_RTOS
+  Adafruit_LTR390_Event() { _sem = xSemaphoreCreateBinary(); }
+  ~Adafruit_LTR390_Event() { vSemaphoreDelete(_sem); }
+  /*!  @brief  Wake the waiter  */
+  void signal(void) { xSemaphoreGive(_sem); }
+  /*!  @brief  Wake the waiter, from an interrupt handler  */
+  void signalFromISR(void) {
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(_sem, &woken);
+#if defined(ESP32)
+    if (woken) {
+      portYIELD_FROM_ISR();
+    }
+#else
+    portYIELD_FROM_ISR(woken);
+#endif
+  }
+  /*!
+   *  @brief  Sleep until signalled
+   *  @param  ms Longest wait in milliseconds
+   *  @return True if signalled, false on timeout
+   */
+  bool wait(uint32_t ms) {
+    return xSemaphoreTake(_sem, pdMS_TO_TICKS(ms)) == pdTRUE;
+  }
+
+private:
+  SemaphoreHandle_t _sem; ///< Binary semaphore
+#else
+  Adafruit_LTR390_Event() : _set(false) {}
+  /*!  @brief  Wake the waiter  */
+  void signal(void) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _set = true;
+    _cond.notify_one();
+  }
+  /*!  @brief  Wake the waiter, a host has no interrupt handlers  */
+  void signalFromISR(void) { signal(); }
+  /*!
+   *  @brief  Sleep until signalled
+   *  @param  ms Longest wait in milliseconds
+   *  @return True if signalled, false on timeout
+   */
+  bool wait(uint32_t ms) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    bool set = _cond.wait_for(lock, std::chrono::milliseconds(ms),
+                              [this] { return _set; });
+    _set = false;
+    return set;
+  }
+
+private:
+  std::mutex _mutex;             ///< Guards _set
+  std::condition_variable _cond; ///< Wakes the waiter
+  bool _set;                     ///< Signalled and not yet waited for
+#endif
+};
+
+/*!
+ *    @brief  A flag one thread sets and another polls, e.g. a stop request.
+ *            Atomic, so unlike a volatile bool the write is seen by other
+ *            cores, in order with the writes before it
+ */
+class Adafruit_LTR390_Flag {
+public:
+  Adafruit_LTR390_Flag() : _value(false) {}
+#if LTR390_RTOS
+  /*!  @brief  Set or clear the flag  @param  value The new value  */
+  void set(bool value) { __atomic_store_n(&_value, value, __ATOMIC_RELEASE); }
+  /*!  @brief  Read the flag  @return The value last set  */
+  bool get(void) { return __atomic_load_n(&_value, __ATOMIC_ACQUIRE); }
+
+private:
+  bool _value; ///< Only accessed through __atomic builtins
+#else
+  /*!  @brief  Set or clear the flag  @param  value The new value  */
+  void set(bool value) { _value.store(value); }
+  /*!  @brief  Read the flag  @return The value last set  */
+  bool get(void) { return _value.load(); }
+
+private:
+  std::atomic<bool> _value; ///< The flag
+#endif
+};
+
+/*!
+ *    @brief  A joinable thread running one function
+ */
+class Adafruit_LTR390_Thread {
+public:
+  /*!  @brief  Signature of the thread's function  */
+  typedef void (*entry_fn)(void *arg);
+
+  Adafruit_LTR390_Thread() : _running(false) {}
+
+  /*!
+   *  @brief  Start the thread
+   *  @param  fn The function to run
+   *  @param  arg Passed to fn
+   *  @param  name Task name, FreeRTOS only
+   *  @param  stack Stack size in bytes, FreeRTOS only
+   *  @param  priority Task priority, FreeRTOS only
+   *  @return True if the thread started
+   */
+  bool start(entry_fn fn, void *arg, const char *name = "ltr390",
+             uint32_t stack = 4096, uint8_t priority = 1) {
+    if (_running) {
+      return false;
+    }
+    _fn = fn;
+    _arg = arg;
+#if LTR390_RTOS
+#if !defined(ESP32)
+    stack /= sizeof(StackType_t); // counted in words outside ESP-IDF
+#endif
+    _running = xTaskCreate(trampoline, name, stack, this, priority, NULL) ==
+               pdPASS;
+#else
+    (void)name;
+    (void)stack;
+    (void)priority;
+    _thread = std::thread(fn, arg);
+    _running = true;
+#endif
+    return _running;
+  }
+
+  /*!  @brief  Wait for the thread's function to return  */
+  void join(void) {
+    if (!_running) {
+      return;
+    }
+#if LTR390_RTOS
+    while (!_done.wait(1000)) {
+    }
+#else
+    _thread.join();
+#endif
+    _running = false;
+  }
+
+  /*!
+   *  @brief  Check if the thread was started and not joined yet
+   *  @return True while running
+   */
+  bool running(void) { return _running; }
+
+private:
+  entry_fn _fn;  ///< The thread's function
+  void *_arg;    ///< Passed to _fn
+  bool _running; ///< Started and not joined
+#if LTR390_RTOS
+  /*!
+   *  @brief  Task entry, runs the function then signals join()
+   *  @param  self The Adafruit_LTR390_Thread
+   */
+  static void trampoline(void *self) {
+    Adafruit_LTR390_Thread *thread = (Adafruit_LTR390_Thread *)self;
+    thread->_fn(thread->_arg);
+    thread->_done.signal();
+    vTaskDelete(NULL);
+  }
+  Adafruit_LTR390_Event _done; ///< Given when the task is finished
+#else
+  std::thread _thread; ///< The std::thread
+#endif
+};
+
+#endif
+
+#endif
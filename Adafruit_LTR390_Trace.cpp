@@ -0,0 +1,300 @@
+/*!
+ *  @file Adafruit_LTR390_Trace.cpp
+ *
+ * 	Bus trace recorder and replayer for the LTR390 UV and light sensor
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Adafruit_LTR390_Trace.h"
+
+/*!
+ *    @brief  Instantiates a trace recorder
+ *    @param  buffer Storage for the ring, e.g. 4096 bytes
+ *    @param  size Size of buffer
+ */
+Adafruit_LTR390_Trace::Adafruit_LTR390_Trace(uint8_t *buffer, size_t size)
+    : _buffer(buffer), _size(size) {
+  clear();
+}
+
+/*!
+ *  @brief  Empty the ring and zero the counters
+ */
+void Adafruit_LTR390_Trace::clear(void) {
+  _head = 0;
+  _tail = 0;
+  _used = 0;
+  _records = 0;
+  _dropped = 0;
+}
+
+/*!
+ *  @brief  Append one transaction, dropping the oldest records to make room
+ *  @param  micros Time the transaction finished
+ *  @param  reg First register
+ *  @param  write True for a write, false for a read
+ *  @param  ack True if the transaction succeeded
+ *  @param  data The bytes written or read
+ *  @param  len Number of bytes, only the first 63 are kept
+ */
+void Adafruit_LTR390_Trace::record(uint32_t micros, uint8_t reg, bool write,
+                                   bool ack, const uint8_t *data, size_t len) {
+  if (len > LTR390_TRACE_LEN_MASK) {
+    len = LTR390_TRACE_LEN_MASK;
+  }
+  size_t need = LTR390_TRACE_HEADER + len;
+  if (need > _size) {
+    _dropped++;
+    return;
+  }
+
+  while (_size - _used < need) {
+    size_t oldest = LTR390_TRACE_HEADER + (at(_tail) & LTR390_TRACE_LEN_MASK);
+    _tail = (_tail + oldest) % _size;
+    _used -= oldest;
+    _records--;
+    _dropped++;
+  }
+
+  put((write ? LTR390_TRACE_WRITE : 0) | (ack ? LTR390_TRACE_ACK : 0) | len);
+  put(reg);
+  put(micros & 0xFF);
+  put((micros >> 8) & 0xFF);
+  put((micros >> 16) & 0xFF);
+  put(micros >> 24);
+  for (size_t i = 0; i < len; i++) {
+    put(data[i]);
+  }
+  _records++;
+}
+
+/*!
+ *  @brief  Copy the trace out, oldest record first, e.g. to send over a
+ *  serial port or store in flash
+ *  @param  out Where to copy the trace
+ *  @param  len Size of out, at least size() to get everything
+ *  @returns Bytes copied, always a whole number of records
+ */
+size_t Adafruit_LTR390_Trace::dump(uint8_t *out, size_t len) {
+  size_t pos = 0;
+  while (pos < _used) {
+    size_t rec = LTR390_TRACE_HEADER +
+                 (at((_tail + pos) % _size) & LTR390_TRACE_LEN_MASK);
+    if (pos + rec > len) {
+      break;
+    }
+    for (size_t i = 0; i < rec; i++) {
+      out[pos + i] = at((_tail + pos + i) % _size);
+    }
+    pos += rec;
+  }
+  return pos;
+}
+
+/*!
+ *  @brief  Get the size of the trace
+ *  @returns Bytes dump() would write
+ */
+size_t Adafruit_LTR390_Trace::size(void) { return _used; }
+
+/*!
+ *  @brief  Get the number of records in the ring
+ *  @returns Record count
+ */
+uint32_t Adafruit_LTR390_Trace::records(void) { return _records; }
+
+/*!
+ *  @brief  Get the number of records lost to overwriting since clear()
+ *  @returns Dropped record count
+ */
+uint32_t Adafruit_LTR390_Trace::dropped(void) { return _dropped; }
+
+/*!
+ *  @brief  Decode one record from a dumped trace
+ *  @param  trace The dump
+ *  @param  len Size of the dump
+ *  @param  pos Offset of the record, 0 for the first
+ *  @param  record Where to put the decoded record
+ *  @returns Offset of the following record, or 0 if there is no complete
+ *  record at pos
+ */
+size_t Adafruit_LTR390_Trace::parse(const uint8_t *trace, size_t len,
+                                    size_t pos, ltr390_trace_record_t *record) {
+  if (pos + LTR390_TRACE_HEADER > len) {
+    return 0;
+  }
+  const uint8_t *p = trace + pos;
+  record->write = p[0] & LTR390_TRACE_WRITE;
+  record->ack = p[0] & LTR390_TRACE_ACK;
+  record->len = p[0] & LTR390_TRACE_LEN_MASK;
+  record->reg = p[1];
+  record->micros = p[2] | ((uint32_t)p[3] << 8) | ((uint32_t)p[4] << 16) |
+                   ((uint32_t)p[5] << 24);
+  record->data = p + LTR390_TRACE_HEADER;
+  if (pos + LTR390_TRACE_HEADER + record->len > len) {
+    return 0;
+  }
+  return pos + LTR390_TRACE_HEADER + record->len;
+}
+
+/*!
+ *  @brief  Append one byte at the head of the ring
+ *  @param  b The byte
+ */
+void Adafruit_LTR390_Trace::put(uint8_t b) {
+  _buffer[_head] = b;
+  _head = (_head + 1) % _size;
+  _used++;
+}
+
+/*!
+ *  @brief  Get one byte of the ring
+ *  @param  pos Offset into the ring storage
+ *  @returns The byte
+ */
+uint8_t Adafruit_LTR390_Trace::at(size_t pos) { return _buffer[pos]; }
+
+static uint32_t replay_millis(void *context) {
+  return ((Adafruit_LTR390_TraceReplay *)context)->micros() / 1000;
+}
+
+static uint32_t replay_micros(void *context) {
+  return ((Adafruit_LTR390_TraceReplay *)context)->micros();
+}
+
+static void replay_delay(void *, uint32_t) {}
+
+/*!
+ *    @brief  Instantiates a replayer
+ *    @param  trace A trace from Adafruit_LTR390_Trace::dump(), must outlive
+ *            the replayer
+ *    @param  len Size of the trace
+ */
+Adafruit_LTR390_TraceReplay::Adafruit_LTR390_TraceReplay(const uint8_t *trace,
+                                                         size_t len)
+    : _trace(trace), _len(len), _pos(0), _mismatches(0), _micros(0) {}
+
+/*!
+ *  @brief  Serve a driver read from the next record
+ *  @param  reg The first register
+ *  @param  buffer Where to put the data
+ *  @param  len How many bytes to read
+ *  @returns The recorded ack, or false on a mismatch
+ */
+bool Adafruit_LTR390_TraceReplay::read(uint8_t reg, uint8_t *buffer,
+                                       size_t len) {
+  ltr390_trace_record_t rec;
+  if (!next(false, reg, len, &rec)) {
+    memset(buffer, 0, len);
+    return false;
+  }
+  memcpy(buffer, rec.data, len);
+  return rec.ack;
+}
+
+/*!
+ *  @brief  Check a driver write against the next record
+ *  @param  reg The first register
+ *  @param  buffer The data
+ *  @param  len How many bytes to write
+ *  @returns The recorded ack, or false on a mismatch
+ */
+bool Adafruit_LTR390_TraceReplay::write(uint8_t reg, const uint8_t *buffer,
+                                        size_t len) {
+  ltr390_trace_record_t rec;
+  if (!next(true, reg, len, &rec)) {
+    return false;
+  }
+  if (memcmp(buffer, rec.data, len) != 0) {
+    _mismatches++;
+  }
+  return rec.ack;
+}
+
+/*!
+ *  @brief  Look at a coming record without consuming it
+ *  @param  record Where to put the record
+ *  @param  ahead Records to look past, 0 for the next one
+ *  @returns False if the trace ends first
+ */
+bool Adafruit_LTR390_TraceReplay::peek(ltr390_trace_record_t *record,
+                                       uint8_t ahead) {
+  size_t pos = _pos;
+  for (uint8_t i = 0; i <= ahead; i++) {
+    pos = Adafruit_LTR390_Trace::parse(_trace, _len, pos, record);
+    if (!pos) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ *  @brief  Consume the next record without replaying it
+ *  @returns False at the end of the trace
+ */
+bool Adafruit_LTR390_TraceReplay::skip(void) {
+  ltr390_trace_record_t rec;
+  size_t next = Adafruit_LTR390_Trace::parse(_trace, _len, _pos, &rec);
+  if (!next) {
+    return false;
+  }
+  _pos = next;
+  _micros = rec.micros;
+  return true;
+}
+
+/*!
+ *  @brief  Check if the whole trace has been replayed
+ *  @returns True at the end of the trace
+ */
+bool Adafruit_LTR390_TraceReplay::done(void) {
+  ltr390_trace_record_t rec;
+  return !peek(&rec);
+}
+
+/*!
+ *  @brief  Get the number of driver transactions that did not match
+ *  @returns Mismatch count
+ */
+uint32_t Adafruit_LTR390_TraceReplay::mismatches(void) { return _mismatches; }
+
+/*!
+ *  @brief  Get the recorded time of the last replayed record
+ *  @returns Microseconds, from the recording device's clock
+ */
+uint32_t Adafruit_LTR390_TraceReplay::micros(void) { return _micros; }
+
+/*!
+ *  @brief  Get a time source that follows the trace's timestamps, for
+ *  setClock(). Delays return at once
+ *  @returns A clock bound to this replayer
+ */
+ltr390_clock_t Adafruit_LTR390_TraceReplay::clock(void) {
+  ltr390_clock_t clk = {replay_millis, replay_micros, replay_delay, this};
+  return clk;
+}
+
+/*!
+ *  @brief  Consume the next record if it matches a driver transaction
+ *  @param  write True for a write, false for a read
+ *  @param  reg The first register
+ *  @param  len Number of bytes
+ *  @param  record Where to put the record
+ *  @returns True if the record matched
+ */
+bool Adafruit_LTR390_TraceReplay::next(bool write, uint8_t reg, size_t len,
+                                       ltr390_trace_record_t *record) {
+  if (!peek(record) || (record->write != write) || (record->reg != reg) ||
+      (record->len != len)) {
+    _mismatches++;
+    return false;
+  }
+  skip();
+  return true;
+}
@@ -0,0 +1,102 @@
+/*!
+ *  @file Adafruit_LTR390_Trace.h
+ *
+ * 	Bus trace recorder and replayer for the LTR390 UV and light sensor
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_TRACE_H
+#define _ADAFRUIT_LTR390_TRACE_H
+
+#include "Adafruit_LTR390.h"
+
+#define LTR390_TRACE_HEADER 6      ///< Bytes in a record before the data
+#define LTR390_TRACE_WRITE 0x80    ///< Record flag: write (else read)
+#define LTR390_TRACE_ACK 0x40      ///< Record flag: transaction succeeded
+#define LTR390_TRACE_LEN_MASK 0x3F ///< Record flag bits holding the length
+
+/*!    @brief  One decoded trace record. On the wire a record is
+ *             [flags|len] [reg] [micros, 4 bytes LSB first] [data...]  */
+typedef struct {
+  uint32_t micros;     ///< Driver clock when the transaction finished
+  uint8_t reg;         ///< First register
+  bool write;          ///< True for a write, false for a read
+  bool ack;            ///< True if the transaction succeeded
+  uint8_t len;         ///< Data bytes
+  const uint8_t *data; ///< The data, inside the dump buffer
+} ltr390_trace_record_t;
+
+/*!
+ *    @brief  Logs every bus transaction the driver makes into a caller
+ *            supplied ring buffer, dropping the oldest records when full.
+ *            Attach with Adafruit_LTR390::setTrace()
+ */
+class Adafruit_LTR390_Trace {
+public:
+  Adafruit_LTR390_Trace(uint8_t *buffer, size_t size);
+
+  void clear(void);
+  void record(uint32_t micros, uint8_t reg, bool write, bool ack,
+              const uint8_t *data, size_t len);
+
+  size_t dump(uint8_t *out, size_t len);
+  size_t size(void);
+  uint32_t records(void);
+  uint32_t dropped(void);
+
+  static size_t parse(const uint8_t *trace, size_t len, size_t pos,
+                      ltr390_trace_record_t *record);
+
+private:
+  void put(uint8_t b);
+  uint8_t at(size_t pos);
+
+  uint8_t *_buffer;  ///< Ring storage
+  size_t _size;      ///< Size of _buffer
+  size_t _head;      ///< Where the next byte goes
+  size_t _tail;      ///< Start of the oldest record
+  size_t _used;      ///< Bytes in use
+  uint32_t _records; ///< Records in the ring
+  uint32_t _dropped; ///< Records overwritten or too big to store
+};
+
+/*!
+ *    @brief  Transport that plays a dumped trace back to the driver. Each
+ *            driver transaction must match the next record; reads return
+ *            the recorded data and ack. Plug in with beginTransport()
+ */
+class Adafruit_LTR390_TraceReplay {
+public:
+  Adafruit_LTR390_TraceReplay(const uint8_t *trace, size_t len);
+
+  bool read(uint8_t reg, uint8_t *buffer, size_t len);
+  bool write(uint8_t reg, const uint8_t *buffer, size_t len);
+
+  bool peek(ltr390_trace_record_t *record, uint8_t ahead = 0);
+  bool skip(void);
+  bool done(void);
+  uint32_t mismatches(void);
+  uint32_t micros(void);
+  ltr390_clock_t clock(void);
+
+private:
+  bool next(bool write, uint8_t reg, size_t len,
+            ltr390_trace_record_t *record);
+
+  const uint8_t *_trace; ///< The dump
+  size_t _len;           ///< Size of the dump
+  size_t _pos;           ///< Next record
+  uint32_t _mismatches;  ///< Transactions that did not match the trace
+  uint32_t _micros;      ///< Time of the last replayed record
+};
+
+#endif
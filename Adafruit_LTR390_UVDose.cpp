@@ -0,0 +1,125 @@
+/*!
+ *  @file Adafruit_LTR390_UVDose.cpp
+ *
+ * 	Erythemal UV dose integrator for the LTR390 UV and light sensor
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include "Adafruit_LTR390_UVDose.h"
+
+// Multipliers that bring a reading to gain 18, indexed by ltr390_gain_t
+static const uint8_t gain_mult[] = {18, 6, 3, 2, 1};
+
+// Multipliers that bring a reading to 20 bit / 400ms integration, indexed by
+// ltr390_resolution_t
+static const uint8_t time_mult[] = {1, 2, 4, 8, 16, 32};
+
+// 1 UVI is 25 mW/m^2 of erythemally weighted irradiance. The accumulator holds
+// twice the normalised counts times milliseconds (trapezoid rule), so one
+// mJ/m^2 is 2 * 2300 * 1000 / 25 accumulator units.
+#define LTR390_DOSE_UNITS_PER_MJ (2ULL * LTR390_UV_SENSITIVITY * 1000 / 25)
+
+/*!
+ *    @brief  Instantiates a new, empty dose integrator
+ */
+Adafruit_LTR390_UVDose::Adafruit_LTR390_UVDose(void) { reset(); }
+
+/*!
+ *  @brief  Clear the accumulated dose and forget the previous sample
+ */
+void Adafruit_LTR390_UVDose::reset(void) {
+  _accum = 0;
+  _prev = 0;
+  _prevTime = 0;
+  _duration = 0;
+  _havePrev = false;
+}
+
+/*!
+ *  @brief  Add one UVS reading to the dose. The interval since the previous
+ *  sample is taken from the timestamps, so missed or late samples are bridged
+ *  by interpolating between the two readings on either side of the gap.
+ *  @param  uvs Raw UVS counts, as returned by readUVS()
+ *  @param  gain The gain the reading was taken at
+ *  @param  res The resolution the reading was taken at
+ *  @param  timestamp When the reading was taken, in ms (e.g. from millis())
+ */
+void Adafruit_LTR390_UVDose::addSample(uint32_t uvs, ltr390_gain_t gain,
+                                       ltr390_resolution_t res,
+                                       uint32_t timestamp) {
+  uint32_t cur = normalize(uvs, gain, res);
+
+  if (_havePrev) {
+    uint32_t dt = timestamp - _prevTime; // wraps cleanly with millis()
+    _accum += ((uint64_t)_prev + cur) * dt;
+    _duration += dt;
+  }
+
+  _prev = cur;
+  _prevTime = timestamp;
+  _havePrev = true;
+}
+
+/*!
+ *  @brief  Get the accumulated erythemal dose
+ *  @returns The dose in J/m^2 (100 J/m^2 is one standard erythemal dose)
+ */
+float Adafruit_LTR390_UVDose::dose(void) {
+  return (float)_accum / (LTR390_DOSE_UNITS_PER_MJ * 1000.0f);
+}
+
+/*!
+ *  @brief  Get the accumulated erythemal dose as an integer
+ *  @returns The dose in mJ/m^2, rounded down
+ */
+uint32_t Adafruit_LTR390_UVDose::doseMilliJoules(void) {
+  return _accum / LTR390_DOSE_UNITS_PER_MJ;
+}
+
+/*!
+ *  @brief  Read out the whole mJ/m^2 accumulated so far and remove them from
+ *  the accumulator. The fraction below one mJ/m^2 is kept, so reporting the
+ *  dose in pieces (e.g. once an hour) adds up to exactly the same total.
+ *  @returns The dose in mJ/m^2 since the last call
+ */
+uint32_t Adafruit_LTR390_UVDose::takeMilliJoules(void) {
+  uint32_t mj = doseMilliJoules();
+  _accum -= (uint64_t)mj * LTR390_DOSE_UNITS_PER_MJ;
+  _duration = 0;
+  return mj;
+}
+
+/*!
+ *  @brief  Get the amount of time covered by the accumulated dose
+ *  @returns Integrated time in ms since reset() or takeMilliJoules()
+ */
+uint32_t Adafruit_LTR390_UVDose::duration(void) { return _duration; }
+
+/*!
+ *  @brief  Convert a raw UVS reading to a UV index
+ *  @param  uvs Raw UVS counts, as returned by readUVS()
+ *  @param  gain The gain the reading was taken at
+ *  @param  res The resolution the reading was taken at
+ *  @returns The UV index
+ */
+float Adafruit_LTR390_UVDose::uvIndex(uint32_t uvs, ltr390_gain_t gain,
+                                      ltr390_resolution_t res) {
+  return (float)normalize(uvs, gain, res) / LTR390_UV_SENSITIVITY;
+}
+
+/*!
+ *  @brief  Scale a raw reading to what it would be at gain 18, 20 bit
+ *  @param  uvs Raw UVS counts
+ *  @param  gain The gain the reading was taken at
+ *  @param  res The resolution the reading was taken at
+ *  @returns Normalised counts, at most 2^20 * 18 * 32 so it fits in 32 bits
+ */
+uint32_t Adafruit_LTR390_UVDose::normalize(uint32_t uvs, ltr390_gain_t gain,
+                                           ltr390_resolution_t res) {
+  return (uvs & 0xFFFFF) * gain_mult[gain] * time_mult[res];
+}
@@ -0,0 +1,57 @@
+/*!
+ *  @file Adafruit_LTR390_UVDose.h
+ *
+ * 	Erythemal UV dose integrator for the LTR390 UV and light sensor
+ *
+ * 	This is a library for the Adafruit LTR390 breakout:
+ * 	http://www.adafruit.com/
+ *
+ * 	Adafruit invests time and resources providing this open source code,
+ *  please support Adafruit and open-source hardware by purchasing products from
+ * 	Adafruit!
+ *
+ *
+ *	BSD license (see license.txt)
+ */
+
+#ifndef _ADAFRUIT_LTR390_UVDOSE_H
+#define _ADAFRUIT_LTR390_UVDOSE_H
+
+#include "Adafruit_LTR390.h"
+
+#define LTR390_UV_SENSITIVITY 2300 ///< UVS counts per UVI at gain 18, 20 bit
+
+/*!
+ *    @brief  Accumulates erythemal UV dose from raw UVS counts. Counts are
+ *            normalised to gain 18 / 20 bit and integrated against the real
+ *            time between samples in a 64 bit fixed point accumulator, so
+ *            no rounding error builds up over a day of samples.
+ */
+class Adafruit_LTR390_UVDose {
+public:
+  Adafruit_LTR390_UVDose();
+
+  void reset(void);
+  void addSample(uint32_t uvs, ltr390_gain_t gain, ltr390_resolution_t res,
+                 uint32_t timestamp);
+
+  float dose(void);
+  uint32_t doseMilliJoules(void);
+  uint32_t takeMilliJoules(void);
+  uint32_t duration(void);
+
+  static float uvIndex(uint32_t uvs, ltr390_gain_t gain,
+                       ltr390_resolution_t res);
+
+private:
+  static uint32_t normalize(uint32_t uvs, ltr390_gain_t gain,
+                            ltr390_resolution_t res);
+
+  uint64_t _accum;    ///< Sum of (prev + cur) * dt_ms, normalised counts
+  uint32_t _prev;     ///< Previous normalised sample
+  uint32_t _prevTime; ///< Timestamp of previous sample, in ms
+  uint32_t _duration; ///< Total integrated time, in ms
+  bool _havePrev;     ///< True once the first sample has been seen
+};
+
+#endif
@@ -0,0 +1,53 @@
+/***************************************************
+  This is an example for the LTR390 UV Sensor
+
+  Reads up to 8 LTR390s behind a TCA9548A I2C multiplexer, one per
+  channel, and prints how many mux switches each round took. AVR boards
+  only have room for LTR390_MUX_SENSORS (4) drivers
+
+  Designed specifically to work with the LTR390 UV sensor from Adafruit
+  ----> https://www.adafruit.com
+
+  These sensors use I2C to communicate, 2 pins are required to
+  interface
+ ****************************************************/
+
+#include "Adafruit_LTR390_Mux.h"
+
+Adafruit_LTR390_Mux mux = Adafruit_LTR390_Mux();
+ltr390_sample_t samples[LTR390_MUX_SENSORS];
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("Adafruit LTR-390 mux");
+
+  if ( ! mux.begin() ) {
+    Serial.println("Couldn't find TCA9548A!");
+    while (1) delay(10);
+  }
+
+  for (uint8_t ch = 0; ch < LTR390_MUX_CHANNELS; ch++) {
+    int8_t index = mux.addSensor(ch);
+    if (index < 0) {
+      continue;
+    }
+    Serial.print("Found LTR sensor on channel "); Serial.println(ch);
+    mux.sensor(index)->setMode(LTR390_MODE_UVS);
+    mux.sensor(index)->setResolution(LTR390_RESOLUTION_16BIT);
+  }
+}
+
+void loop() {
+  mux.resetSwitches();
+  uint8_t fresh = mux.sampleRound(samples);
+
+  for (uint8_t i = 0; i < mux.sensors(); i++) {
+    if (fresh & (1 << i)) {
+      Serial.print("Channel "); Serial.print(mux.channel(i));
+      Serial.print(" UV data: "); Serial.println(samples[i].counts);
+    }
+  }
+  Serial.print("Mux switches: "); Serial.println(mux.switches());
+
+  delay(100);
+}
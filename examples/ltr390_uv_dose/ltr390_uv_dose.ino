@@ -0,0 +1,48 @@
+/***************************************************
+  This is an example for the LTR390 UV Sensor
+
+  Integrates the erythemal UV dose and prints it once a minute
+
+  Designed specifically to work with the LTR390 UV sensor from Adafruit
+  ----> https://www.adafruit.com
+
+  These sensors use I2C to communicate, 2 pins are required to
+  interface
+ ****************************************************/
+
+#include "Adafruit_LTR390.h"
+#include "Adafruit_LTR390_UVDose.h"
+
+Adafruit_LTR390 ltr = Adafruit_LTR390();
+Adafruit_LTR390_UVDose uvdose = Adafruit_LTR390_UVDose();
+
+uint32_t last_report = 0;
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("Adafruit LTR-390 UV dose");
+
+  if ( ! ltr.begin() ) {
+    Serial.println("Couldn't find LTR sensor!");
+    while (1) delay(10);
+  }
+
+  ltr.setMode(LTR390_MODE_UVS);
+  ltr.setGain(LTR390_GAIN_18);
+  ltr.setResolution(LTR390_RESOLUTION_20BIT);
+}
+
+void loop() {
+  if (ltr.newDataAvailable()) {
+    uvdose.addSample(ltr.readUVS(), LTR390_GAIN_18, LTR390_RESOLUTION_20BIT,
+                     millis());
+  }
+
+  if (millis() - last_report >= 60000) {
+    last_report = millis();
+    Serial.print("UV dose last minute (mJ/m^2): ");
+    Serial.println(uvdose.takeMilliJoules());
+  }
+
+  delay(50);
+}
@@ -0,0 +1,163 @@
+/*!
+ *  @file ltr390_bench.cpp
+ *
+ * 	Host benchmark of acquisition strategies for the LTR390 driver, run
+ * 	against Adafruit_LTR390_Sim on virtual time. The sensor stretches the
+ * 	clock by a seeded random time on every transaction, so latency has a
+ * 	spread and the p99 column means something, and runs still repeat
+ *
+ * 	Build and run with 'make run' in this directory. Optional arguments
+ * 	are the bus clock in Hz and the longest clock stretch in us
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <Adafruit_LTR390.h>
+#include <Adafruit_LTR390_Sim.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_SAMPLES 50     ///< Readings collected per run
+#define BENCH_POLL_US 5000   ///< Interval of the polling strategies
+#define BENCH_SLACK_US 200   ///< Deadline strategy wakes this long after due
+#define BENCH_STRETCH_US 100 ///< Default longest clock stretch
+#define BENCH_SEED 1         ///< Clock stretch generator seed, every run
+
+typedef enum {
+  STRATEGY_POLL,     ///< newDataAvailable() every 5ms, then readALS()
+  STRATEGY_DEADLINE, ///< Sleep until the next reading is due, then as POLL
+  STRATEGY_IRQ,      ///< Wake on the INT pin, then as POLL
+  STRATEGY_BURST,    ///< readNewData() every 5ms
+  STRATEGY_COUNT,
+} strategy_t;
+
+static const char *strategy_names[] = {"poll", "deadline", "irq", "burst"};
+static const char *res_names[] = {"20", "19", "18", "17", "16", "13"};
+static const char *rate_names[] = {"25",  "50",   "100", "200",
+                                   "500", "1000", "2000"};
+
+/*!    @brief  Results of one run  */
+typedef struct {
+  double transactions; ///< Bus transactions per reading
+  double bytes;        ///< Bus bytes (both directions) per reading
+  double avgLatency;   ///< Mean data-ready to read-done time, us
+  double p99Latency;   ///< 99th percentile of the same, us
+  double wakeups;      ///< CPU wakeups per second
+} result_t;
+
+static result_t run(strategy_t strategy, ltr390_resolution_t res,
+                    ltr390_rate_t rate, uint32_t bus_hz,
+                    uint32_t stretch_us) {
+  Adafruit_LTR390_Sim sim;
+  Adafruit_LTR390 ltr;
+  ltr390_clock_t clock = sim.clock();
+
+  sim.setLight(20000, 2000);
+  sim.setBusClock(bus_hz);
+  sim.setClockStretch(stretch_us, BENCH_SEED);
+  ltr.setClock(&clock);
+  ltr.beginTransport(&sim);
+  ltr.setResolution(res);
+  ltr.setMeasurementRate(rate);
+  if (strategy == STRATEGY_IRQ) {
+    ltr.setThresholds(0, 0); // every non-zero reading is out of range
+    ltr.configInterrupt(true, LTR390_MODE_ALS);
+  }
+
+  // skip the reading in flight when the settings changed, and the one
+  // after it, which started on the old measurement rate
+  ltr390_sample_t sample;
+  for (int i = 0; i < 2; i++) {
+    while (!ltr.newDataAvailable()) {
+      sim.advance(1000);
+    }
+    ltr.readALS(&sample);
+  }
+
+  uint32_t period = Adafruit_LTR390::periodMicros(res, rate);
+  uint64_t start = sim.micros();
+  uint64_t due = sim.lastConversion() + period;
+  uint32_t wakeups = 0;
+  std::vector<uint64_t> latency;
+  sim.resetCounters();
+
+  while (latency.size() < BENCH_SAMPLES) {
+    switch (strategy) {
+    case STRATEGY_POLL:
+    case STRATEGY_BURST:
+      sim.advance(BENCH_POLL_US);
+      break;
+    case STRATEGY_DEADLINE:
+      if (sim.micros() < due + BENCH_SLACK_US) {
+        sim.advance(due + BENCH_SLACK_US - sim.micros());
+      } else {
+        sim.advance(1000); // late, poll until it shows up
+      }
+      break;
+    case STRATEGY_IRQ:
+      while (!sim.interrupt()) {
+        sim.advance(sim.nextConversionIn());
+      }
+      break;
+    default:
+      break;
+    }
+    wakeups++;
+
+    bool fresh;
+    if (strategy == STRATEGY_BURST) {
+      fresh = ltr.readNewData(&sample);
+    } else {
+      fresh = ltr.newDataAvailable() && ltr.readALS(&sample);
+    }
+    if (fresh) {
+      latency.push_back(sim.micros() - sim.lastConversion());
+      due = sim.lastConversion() + period;
+    }
+  }
+
+  double seconds = (sim.micros() - start) / 1e6;
+  std::sort(latency.begin(), latency.end());
+  double sum = 0;
+  for (size_t i = 0; i < latency.size(); i++) {
+    sum += latency[i];
+  }
+
+  result_t r;
+  r.transactions = (double)sim.transactions() / BENCH_SAMPLES;
+  r.bytes = (double)(sim.bytesRead() + sim.bytesWritten()) / BENCH_SAMPLES;
+  r.avgLatency = sum / latency.size();
+  r.p99Latency = latency[(latency.size() * 99) / 100];
+  r.wakeups = wakeups / seconds;
+  return r;
+}
+
+int main(int argc, char **argv) {
+  uint32_t bus_hz = (argc > 1) ? strtoul(argv[1], NULL, 0) : 400000;
+  uint32_t stretch_us =
+      (argc > 2) ? strtoul(argv[2], NULL, 0) : BENCH_STRETCH_US;
+
+  printf("LTR390 acquisition benchmark, %u Hz bus, clock stretch up to %u "
+         "us, %d readings per run\n\n",
+         bus_hz, stretch_us, BENCH_SAMPLES);
+  printf("%-4s %-5s %-9s %8s %8s %10s %10s %9s\n", "bits", "ms", "strategy",
+         "txn/rd", "B/rd", "avg us", "p99 us", "wake/s");
+
+  for (int res = LTR390_RESOLUTION_20BIT; res <= LTR390_RESOLUTION_13BIT;
+       res++) {
+    for (int rate = LTR390_RATE_25MS; rate <= LTR390_RATE_2000MS; rate++) {
+      for (int s = 0; s < STRATEGY_COUNT; s++) {
+        result_t r = run((strategy_t)s, (ltr390_resolution_t)res,
+                         (ltr390_rate_t)rate, bus_hz, stretch_us);
+        printf("%-4s %-5s %-9s %8.2f %8.1f %10.0f %10.0f %9.1f\n",
+               res_names[res], rate_names[rate], strategy_names[s],
+               r.transactions, r.bytes, r.avgLatency, r.p99Latency,
+               r.wakeups);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,204 @@
+/*!
+ *  @file ltr390_budget.cpp
+ *
+ * 	Host tool that plans the I2C bus load of a fleet of LTR390s with
+ * 	Adafruit_LTR390_Budget, and checks each sensor's share by running the
+ * 	driver against Adafruit_LTR390_Sim
+ *
+ * 	ltr390_budget [-c hz] [-t percent] [-p ms] [-s] [-m] sensor...
+ * 	  sensor is mode:bits:ms, e.g. uvs:18:100 for UVS, 18 bit, 100ms rate
+ * 	  -c  bus clock, default 100000
+ * 	  -t  target utilisation, default 50
+ * 	  -p  time between checks of each sensor, default 0 for the INT pin
+ * 	  -s  check with newDataAvailable() and readALS()/readUVS() instead of
+ * 	      readNewData()
+ * 	  -m  sensors are behind a TCA9548A, sampled in rounds
+ *
+ * 	Exits 1 if the plan is over the target. Build with 'make' in this
+ * 	directory
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <Adafruit_LTR390.h>
+#include <Adafruit_LTR390_Budget.h>
+#include <Adafruit_LTR390_Sim.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_SECONDS 10 ///< Virtual time each sensor is simulated for
+
+static const int res_bits[] = {20, 19, 18, 17, 16, 13};
+static const int rate_ms[] = {25, 50, 100, 200, 500, 1000, 2000};
+
+static bool parse_sensor(const char *arg, ltr390_mode_t *mode,
+                         ltr390_resolution_t *res, ltr390_rate_t *rate) {
+  char name[4];
+  int bits, ms;
+  if (sscanf(arg, "%3[a-z]:%d:%d", name, &bits, &ms) != 3) {
+    return false;
+  }
+  if (strcmp(name, "als") == 0) {
+    *mode = LTR390_MODE_ALS;
+  } else if (strcmp(name, "uvs") == 0) {
+    *mode = LTR390_MODE_UVS;
+  } else {
+    return false;
+  }
+
+  int r = 0;
+  while ((r < 6) && (res_bits[r] != bits)) {
+    r++;
+  }
+  int m = 0;
+  while ((m < 7) && (rate_ms[m] != ms)) {
+    m++;
+  }
+  if ((r == 6) || (m == 7)) {
+    return false;
+  }
+  *res = (ltr390_resolution_t)r;
+  *rate = (ltr390_rate_t)m;
+  return true;
+}
+
+// Bus time per second of one sensor, measured by the simulator
+static double simulate(const ltr390_budget_sensor_t *s,
+                       ltr390_access_t access, uint32_t interval,
+                       uint32_t bus_hz) {
+  Adafruit_LTR390_Sim sim;
+  Adafruit_LTR390 ltr;
+  ltr390_clock_t clock = sim.clock();
+
+  sim.setLight(20000, 2000);
+  sim.setBusClock(bus_hz);
+  ltr.setClock(&clock);
+  ltr.beginTransport(&sim);
+  ltr.setMode(s->mode);
+  ltr.setResolution(s->resolution);
+  ltr.setMeasurementRate(s->rate);
+
+  // skip the reading in flight when the settings changed, and the one
+  // after it, which started on the old measurement rate
+  ltr390_sample_t sample;
+  for (int i = 0; i < 2; i++) {
+    while (!ltr.readNewData(&sample)) {
+      sim.advance(1000);
+    }
+  }
+
+  sim.resetCounters();
+  uint64_t end = sim.micros() + SIM_SECONDS * 1000000ULL;
+  uint64_t due = sim.micros();
+  while (sim.micros() < end) {
+    // checks on a fixed schedule, however long each one took, or with no
+    // interval just after each conversion like the INT pin
+    if (interval) {
+      due += interval;
+      if (due > sim.micros()) {
+        sim.advance(due - sim.micros());
+      }
+    } else {
+      sim.advance(sim.nextConversionIn() + 100);
+    }
+    if (access == LTR390_ACCESS_BURST) {
+      ltr.readNewData(&sample);
+    } else if (ltr.newDataAvailable()) {
+      if (s->mode == LTR390_MODE_UVS) {
+        ltr.readUVS(&sample);
+      } else {
+        ltr.readALS(&sample);
+      }
+    }
+  }
+  return (double)sim.busMicros() / SIM_SECONDS;
+}
+
+static int usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [-c hz] [-t percent] [-p ms] [-s] [-m] sensor...\n"
+          "  sensor is mode:bits:ms, e.g. uvs:18:100\n",
+          name);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  uint32_t bus_hz = 100000;
+  double target = 50;
+  double poll_ms = 0;
+  ltr390_access_t access = LTR390_ACCESS_BURST;
+  bool mux = false;
+  Adafruit_LTR390_Budget budget;
+  ltr390_budget_sensor_t sensors[LTR390_BUDGET_SENSORS];
+
+  for (int i = 1; i < argc; i++) {
+    ltr390_budget_sensor_t *s = &sensors[budget.sensors()];
+    if ((strcmp(argv[i], "-c") == 0) && (i + 1 < argc)) {
+      bus_hz = strtoul(argv[++i], NULL, 0);
+    } else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc)) {
+      target = atof(argv[++i]);
+    } else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc)) {
+      poll_ms = atof(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      access = LTR390_ACCESS_STATUS;
+    } else if (strcmp(argv[i], "-m") == 0) {
+      mux = true;
+    } else if (budget.sensors() == LTR390_BUDGET_SENSORS) {
+      fprintf(stderr, "at most %d sensors\n", LTR390_BUDGET_SENSORS);
+      return 2;
+    } else if (parse_sensor(argv[i], &s->mode, &s->resolution, &s->rate)) {
+      budget.addSensor(s->mode, s->resolution, s->rate);
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  if ((budget.sensors() == 0) || (bus_hz == 0)) {
+    return usage(argv[0]);
+  }
+
+  uint32_t poll_us = (uint32_t)(poll_ms * 1000);
+  budget.setBusClock(bus_hz);
+  budget.setAccess(access, poll_us);
+  budget.setMux(mux);
+
+  printf("LTR390 bus budget, %u Hz, %s ", bus_hz,
+         (access == LTR390_ACCESS_BURST) ? "readNewData()"
+                                         : "newDataAvailable() + read");
+  if (poll_us) {
+    printf("every %.1f ms", poll_ms);
+  } else {
+    printf("on %s", mux ? "the fastest sensor's readings" : "each reading");
+  }
+  printf("%s, target %.0f%%\n\n", mux ? " in mux rounds" : "", target);
+  printf("%-3s %-4s %-4s %-5s %9s %9s %10s %8s %8s\n", "#", "mode", "bits",
+         "ms", "checks/s", "reads/s", "bits/s", "bus %", "sim %");
+
+  ltr390_budget_t load;
+  for (uint8_t i = 0; i < budget.sensors(); i++) {
+    const ltr390_budget_sensor_t *s = &sensors[i];
+    budget.sensorLoad(i, &load);
+    // a mux round checks every sensor, so simulate on the round interval
+    uint32_t interval = poll_us;
+    if (mux && !interval) {
+      interval = (uint32_t)(1e6f / load.checks + 0.5f);
+    }
+    double sim = simulate(s, access, interval, bus_hz);
+    printf("%-3u %-4s %-4d %-5d %9.1f %9.1f %10.0f %8.3f %8.3f\n", i,
+           (s->mode == LTR390_MODE_UVS) ? "uvs" : "als",
+           res_bits[s->resolution], rate_ms[s->rate], load.checks,
+           load.dataReads, load.bits, load.utilisation * 100, sim / 1e4);
+  }
+
+  budget.busLoad(&load);
+  if (mux) {
+    printf("mux switches/s %.1f, %.0f bits/s\n", load.muxSwitches,
+           load.muxSwitches * Adafruit_LTR390_Budget::writeBits(0));
+  }
+  bool fits = budget.fits(target / 100);
+  printf("total %9.1f checks/s %9.1f reads/s %10.0f bits/s %7.3f%%  %s\n",
+         load.checks, load.dataReads, load.bits, load.utilisation * 100,
+         fits ? "ok" : "OVER TARGET");
+  return fits ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+/*!
+ *  @file ltr390_dark_check.cpp
+ *
+ * 	Host check that calibrateDark() averages only readings taken at the
+ * 	settings it calibrates, whatever the settings before and wherever the
+ * 	sensor was in its conversion cycle when it was called
+ *
+ * 	Build and run with 'make run' in this directory
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <Adafruit_LTR390.h>
+#include <Adafruit_LTR390_Sim.h>
+
+#include <stdio.h>
+
+#define DARK_ALS 250   ///< Simulated dark level, counts at gain 1, 20 bit
+#define PHASE_STEPS 16 ///< Call times tried across two measurement periods
+
+static void settle(Adafruit_LTR390_Sim *sim, Adafruit_LTR390 *ltr) {
+  ltr390_sample_t sample;
+  for (int i = 0; i < LTR390_STALE_READINGS + 1; i++) {
+    while (!ltr->readNewData(&sample)) {
+      sim->advance(1000);
+    }
+  }
+}
+
+// What the sensor reads in the dark once it has settled at gain and res
+static uint32_t expected(ltr390_gain_t gain, ltr390_resolution_t res) {
+  Adafruit_LTR390_Sim sim;
+  Adafruit_LTR390 ltr;
+  ltr390_clock_t clock = sim.clock();
+  ltr390_sample_t sample;
+
+  sim.setLight(DARK_ALS, 0);
+  ltr.setClock(&clock);
+  ltr.beginTransport(&sim);
+  ltr.setGain(gain);
+  ltr.setResolution(res);
+  settle(&sim, &ltr);
+  while (!ltr.readNewData(&sample)) {
+    sim.advance(1000);
+  }
+  return sample.counts;
+}
+
+int main(void) {
+  const ltr390_gain_t gains[] = {LTR390_GAIN_1, LTR390_GAIN_3, LTR390_GAIN_18};
+  const ltr390_resolution_t resolutions[] = {
+      LTR390_RESOLUTION_20BIT, LTR390_RESOLUTION_18BIT,
+      LTR390_RESOLUTION_16BIT, LTR390_RESOLUTION_13BIT};
+  int runs = 0, failures = 0;
+
+  for (int g = 0; g < 3; g++) {
+    for (int r = 0; r < 4; r++) {
+      uint32_t want = expected(gains[g], resolutions[r]);
+      for (int g0 = 0; g0 < 3; g0++) {
+        for (int r0 = 0; r0 < 4; r0++) {
+          if ((g0 == g) && (r0 == r)) {
+            continue;
+          }
+          uint32_t period = Adafruit_LTR390::periodMicros(resolutions[r0],
+                                                          LTR390_RATE_100MS);
+          for (int phase = 0; phase < PHASE_STEPS; phase++) {
+            Adafruit_LTR390_Sim sim;
+            Adafruit_LTR390 ltr;
+            ltr390_clock_t clock = sim.clock();
+
+            sim.setLight(DARK_ALS, 0);
+            ltr.setClock(&clock);
+            ltr.beginTransport(&sim);
+            ltr.setGain(gains[g0]);
+            ltr.setResolution(resolutions[r0]);
+            settle(&sim, &ltr);
+            // past one period a reading at the old settings is left waiting
+            sim.advance(2 * period * phase / PHASE_STEPS);
+
+            bool ok = ltr.calibrateDark(gains[g], resolutions[r], 4);
+            uint16_t got = ltr.getDarkOffset(gains[g], resolutions[r]);
+            runs++;
+            if (!ok || (got != want)) {
+              failures++;
+              printf("FAIL gain %d res %d from gain %d res %d, phase %d/%d: "
+                     "offset %u, want %u\n",
+                     gains[g], resolutions[r], gains[g0], resolutions[r0],
+                     phase, PHASE_STEPS / 2, got, want);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  printf("dark calibration: %d runs, %d failures\n", runs, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+/*!
+ *  @file ltr390_group_check.cpp
+ *
+ * 	Host check of Adafruit_LTR390_Group with two simulated buses. Every
+ * 	bus transaction sleeps, as a slow I2C bus would, longer on one bus
+ * 	than the other, and each bus logs how long it was busy in the round.
+ * 	As the buses are read in parallel a round must take about as long as
+ * 	the busiest bus, well short of the sum of both, the buses must start
+ * 	together, and every result in the batch must have been read inside
+ * 	the round
+ *
+ * 	Build and run with 'make run' in this directory
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <Adafruit_LTR390.h>
+#include <Adafruit_LTR390_Group.h>
+#include <Adafruit_LTR390_Sim.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+#define ROUNDS 5 ///< Rounds sampled
+
+static uint32_t now(void) {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/*!
+ *    @brief  One I2C bus, shared by its sensors. Only its worker calls it
+ *            while the group runs, and the round's events order that with
+ *            the main thread's reads and resets of the log
+ */
+typedef struct {
+  uint32_t delayMs; ///< Time each transaction takes, 0 while setting up
+  uint32_t busy;    ///< Microseconds spent on the bus this round
+  uint32_t first;   ///< now() at the first transaction this round
+} bus_t;
+
+/*!
+ *    @brief  Simulated sensor on a slow bus. Moves time on to the next
+ *            conversion at each status check, so every round has data
+ */
+class SlowSensor {
+public:
+  /*!  @brief  Reads registers, see Adafruit_LTR390_Sim::read()  */
+  bool read(uint8_t reg, uint8_t *buffer, size_t len) {
+    uint32_t start = transfer();
+    if (reg == LTR390_MAIN_STATUS) {
+      sim.advance(sim.nextConversionIn() + 100);
+    }
+    bool ok = sim.read(reg, buffer, len);
+    bus->busy += now() - start;
+    return ok;
+  }
+  /*!  @brief  Writes registers, see Adafruit_LTR390_Sim::write()  */
+  bool write(uint8_t reg, const uint8_t *buffer, size_t len) {
+    uint32_t start = transfer();
+    bool ok = sim.write(reg, buffer, len);
+    bus->busy += now() - start;
+    return ok;
+  }
+
+  Adafruit_LTR390_Sim sim; ///< The sensor
+  bus_t *bus;              ///< The bus it is on
+
+private:
+  uint32_t transfer(void) {
+    uint32_t start = now();
+    if (bus->delayMs) {
+      if (!bus->busy && !bus->first) {
+        bus->first = start;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(bus->delayMs));
+    }
+    return start;
+  }
+};
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+  if (!ok) {
+    printf("group check failed: %s\n", what);
+    failures++;
+  }
+}
+
+int main(void) {
+  // bus 0 holds two sensors, bus 1 one slower one
+  bus_t buses[2] = {{20, 0, 0}, {30, 0, 0}};
+  const uint8_t sensorBus[3] = {0, 0, 1};
+  SlowSensor sensors[3];
+  Adafruit_LTR390 ltr[3];
+  Adafruit_LTR390_Group group;
+
+  for (int i = 0; i < 3; i++) {
+    uint32_t delayMs = buses[sensorBus[i]].delayMs;
+    buses[sensorBus[i]].delayMs = 0;
+    sensors[i].bus = &buses[sensorBus[i]];
+    sensors[i].sim.setLight(20000, 2000);
+    expect(ltr[i].beginTransport(&sensors[i]), "begin");
+    buses[sensorBus[i]].delayMs = delayMs;
+    expect(group.addSensor(sensorBus[i], &ltr[i]) == i, "addSensor");
+  }
+  expect(group.start(), "start");
+
+  ltr390_group_result_t results[3];
+  uint32_t worstRound = 0, worstSpread = 0;
+  for (int r = 0; r < ROUNDS; r++) {
+    for (int b = 0; b < 2; b++) {
+      buses[b].busy = 0;
+      buses[b].first = 0;
+    }
+    uint32_t start = now();
+    uint8_t fresh = group.sampleRound(results);
+    uint32_t end = now();
+    expect(fresh == 3, "a sensor had no new reading");
+
+    uint32_t slowest = buses[0].busy, fastest = buses[1].busy;
+    if (slowest < fastest) {
+      slowest = buses[1].busy;
+      fastest = buses[0].busy;
+    }
+    uint32_t round = group.roundMicros();
+    expect(round >= slowest, "round shorter than the busiest bus");
+    // run one after the other the buses would take slowest + fastest
+    expect(round < slowest + fastest / 2, "buses were not read in parallel");
+    if (round - slowest > worstRound) {
+      worstRound = round - slowest;
+    }
+
+    uint32_t spread = (buses[0].first > buses[1].first)
+                          ? buses[0].first - buses[1].first
+                          : buses[1].first - buses[0].first;
+    expect(spread < buses[0].delayMs * 1000 / 2,
+           "buses did not start together");
+    if (spread > worstSpread) {
+      worstSpread = spread;
+    }
+    for (int i = 0; i < 3; i++) {
+      expect((results[i].micros - start) <= (end - start),
+             "result read outside its round");
+    }
+  }
+  group.stop();
+
+  printf("group: %d rounds, at most %u us over the busiest bus, buses "
+         "started within %u us\n",
+         ROUNDS, worstRound, worstSpread);
+  return failures ? 1 : 0;
+}
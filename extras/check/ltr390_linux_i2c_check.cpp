@@ -0,0 +1,188 @@
+/*!
+ *  @file ltr390_linux_i2c_check.cpp
+ *
+ * 	Host check of Adafruit_LTR390_LinuxI2C against a fake i2c-dev: its
+ * 	ioctl hook hands each I2C_RDWR transfer to a simulated sensor. The
+ * 	driver runs through a configuration and some readings, and every
+ * 	register read must be exactly one I2C_RDWR holding a one byte write of
+ * 	the register then a read, every register write one I2C_RDWR with one
+ * 	write message, and nothing may read() or write() the bus. A failed or
+ * 	short transfer must come back to the driver as a bus error
+ *
+ * 	Build and run with 'make run' in this directory, Linux only
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <Adafruit_LTR390.h>
+#include <Adafruit_LTR390_LinuxI2C.h>
+#include <Adafruit_LTR390_Sim.h>
+
+#include <errno.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define FAKE_FD 1000 ///< Descriptor of the fake bus, never really open
+#define ADDR 0x53    ///< Sensor address
+
+/*!    @brief  What the fake bus saw  */
+typedef struct {
+  Adafruit_LTR390_Sim *sim; ///< The sensor on the bus
+  uint32_t ioctls;          ///< I2C_RDWR transfers
+  uint32_t malformed;       ///< Transfers not shaped like a register access
+  uint32_t syscalls;        ///< read() or write() calls on the bus
+  uint8_t fail;             ///< Transfers left to fail
+  int result;               ///< What a failing transfer returns
+} fake_bus_t;
+
+static fake_bus_t fake;
+
+// Stand in for the C library's read() and write(), counting any use of
+// the bus and passing everything else on
+extern "C" ssize_t read(int fd, void *buf, size_t count) {
+  if (fd == FAKE_FD) {
+    fake.syscalls++;
+    errno = EBADF;
+    return -1;
+  }
+  return syscall(SYS_read, fd, buf, count);
+}
+
+extern "C" ssize_t write(int fd, const void *buf, size_t count) {
+  if (fd == FAKE_FD) {
+    fake.syscalls++;
+    errno = EBADF;
+    return -1;
+  }
+  return syscall(SYS_write, fd, buf, count);
+}
+
+static int fake_ioctl(int fd, unsigned long request, void *arg) {
+  if ((fd != FAKE_FD) || (request != I2C_RDWR)) {
+    fake.malformed++;
+    errno = EINVAL;
+    return -1;
+  }
+  fake.ioctls++;
+  struct i2c_rdwr_ioctl_data *xfer = (struct i2c_rdwr_ioctl_data *)arg;
+  struct i2c_msg *msgs = xfer->msgs;
+  for (uint32_t i = 0; i < xfer->nmsgs; i++) {
+    if (msgs[i].addr != ADDR) {
+      fake.malformed++;
+    }
+  }
+  if (fake.fail) {
+    fake.fail--;
+    if (fake.result < 0) {
+      errno = EIO;
+    }
+    return fake.result;
+  }
+
+  if ((xfer->nmsgs == 2) && (msgs[0].flags == 0) && (msgs[0].len == 1) &&
+      (msgs[1].flags == I2C_M_RD) && (msgs[1].len > 0)) {
+    if (!fake.sim->read(msgs[0].buf[0], msgs[1].buf, msgs[1].len)) {
+      errno = EREMOTEIO;
+      return -1;
+    }
+    return 2;
+  }
+  if ((xfer->nmsgs == 1) && (msgs[0].flags == 0) && (msgs[0].len > 1)) {
+    if (!fake.sim->write(msgs[0].buf[0], msgs[0].buf + 1, msgs[0].len - 1)) {
+      errno = EREMOTEIO;
+      return -1;
+    }
+    return 1;
+  }
+  fake.malformed++;
+  errno = EINVAL;
+  return -1;
+}
+
+/*!    @brief  Counts the register accesses the driver asks for  */
+class CountingBus {
+public:
+  /*!  @brief  Reads registers, see Adafruit_LTR390_LinuxI2C::read()  */
+  bool read(uint8_t reg, uint8_t *buffer, size_t len) {
+    accesses++;
+    return bus->read(reg, buffer, len);
+  }
+  /*!  @brief  Writes registers, see Adafruit_LTR390_LinuxI2C::write()  */
+  bool write(uint8_t reg, const uint8_t *buffer, size_t len) {
+    accesses++;
+    return bus->write(reg, buffer, len);
+  }
+
+  Adafruit_LTR390_LinuxI2C *bus; ///< The backend under test
+  uint32_t accesses;             ///< Reads and writes passed on
+};
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+  if (!ok) {
+    printf("linux i2c check failed: %s\n", what);
+    failures++;
+  }
+}
+
+int main(void) {
+  Adafruit_LTR390_Sim sim;
+  Adafruit_LTR390_LinuxI2C i2c(fake_ioctl);
+  CountingBus counting = {&i2c, 0};
+  Adafruit_LTR390 ltr;
+  ltr390_clock_t clock = sim.clock();
+  ltr390_sample_t sample;
+  fake.sim = &sim;
+
+  uint8_t id;
+  expect(!i2c.read(LTR390_PART_ID, &id, 1), "read before begin succeeded");
+  expect(fake.ioctls == 0, "ioctl before begin");
+
+  sim.setLight(20000, 2000);
+  i2c.begin(FAKE_FD, ADDR);
+  ltr.setClock(&clock);
+  expect(ltr.beginTransport(&counting), "begin");
+  ltr.setGain(LTR390_GAIN_18);
+  ltr.setResolution(LTR390_RESOLUTION_16BIT);
+  ltr.setMode(LTR390_MODE_UVS);
+  for (int i = 0; i < 20; i++) {
+    sim.advance(sim.nextConversionIn() + 100);
+    ltr.readNewData(&sample);
+  }
+  expect(ltr.getGain() == LTR390_GAIN_18, "gain did not read back");
+  expect(fake.ioctls == counting.accesses,
+         "register accesses are not one ioctl each");
+  expect(fake.ioctls == sim.transactions(),
+         "transfers are not one bus transaction each");
+  expect(fake.malformed == 0, "a transfer was not a register access");
+  expect(fake.syscalls == 0, "the bus was read() or written()");
+
+  // failed transfers, then ones where the device stopped acking early
+  const int readResults[2] = {-1, 1};
+  const int writeResults[2] = {-1, 0};
+  for (int i = 0; i < 2; i++) {
+    fake.fail = 1;
+    fake.result = readResults[i];
+    expect(!i2c.read(LTR390_PART_ID, &id, 1), "failed read returned true");
+    fake.fail = 1;
+    sim.advance(sim.nextConversionIn() + 100);
+    expect(!ltr.readNewData(&sample), "failed reading returned true");
+    expect(ltr.lastStatus() == LTR390_BUS_ERROR, "failure not a bus error");
+    fake.fail = 1;
+    fake.result = writeResults[i];
+    uint8_t gain = 0x01;
+    expect(!i2c.write(LTR390_GAIN, &gain, 1), "failed write returned true");
+    fake.fail = 1;
+    expect(!ltr.restoreConfig(), "failed restore returned true");
+  }
+  fake.fail = 0;
+  expect(ltr.restoreConfig(), "bus did not recover");
+
+  printf("linux i2c: %u transfers, %u malformed, %u read()/write()\n",
+         fake.ioctls, fake.malformed, fake.syscalls);
+  return failures ? 1 : 0;
+}
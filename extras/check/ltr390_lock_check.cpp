@@ -0,0 +1,124 @@
+/*!
+ *  @file ltr390_lock_check.cpp
+ *
+ * 	Host check of setBusLock(): threads share one driver and one simulated
+ * 	sensor through a std::recursive_mutex. Two of them each own one field
+ * 	of MEAS_RATE, the resolution and the measurement rate, and set it with
+ * 	a read-modify-write of the whole register, then read it back. Without
+ * 	the lock around each call one thread's write can undo the other's. A
+ * 	third thread reads the sensor and takes its status flags meanwhile.
+ * 	Every call must find its own field as it left it, and the lock must
+ * 	have been taken once per outermost call
+ *
+ * 	Build and run with 'make run' in this directory
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <Adafruit_LTR390.h>
+#include <Adafruit_LTR390_Sim.h>
+#include <Adafruit_LTR390_Thread.h>
+
+#include <mutex>
+#include <stdio.h>
+
+#define ROUNDS 50000 ///< Calls each thread makes
+
+/*!    @brief  State shared by the threads  */
+typedef struct {
+  Adafruit_LTR390 *ltr;       ///< The shared driver
+  Adafruit_LTR390_Sim *sim;   ///< The shared sensor
+  std::recursive_mutex mutex; ///< The bus lock
+  uint32_t lost;              ///< Read-backs that found another value
+  uint32_t calls;             ///< Outermost API calls made
+} shared_t;
+
+static void lock(void *context) { ((shared_t *)context)->mutex.lock(); }
+
+static void unlock(void *context) { ((shared_t *)context)->mutex.unlock(); }
+
+static void resolutions(void *context) {
+  shared_t *s = (shared_t *)context;
+  const ltr390_resolution_t res[] = {LTR390_RESOLUTION_20BIT,
+                                     LTR390_RESOLUTION_16BIT,
+                                     LTR390_RESOLUTION_13BIT};
+  uint32_t lost = 0;
+  for (uint32_t i = 0; i < ROUNDS; i++) {
+    s->ltr->setResolution(res[i % 3]);
+    if (s->ltr->getResolution() != res[i % 3]) {
+      lost++;
+    }
+  }
+  std::lock_guard<std::recursive_mutex> guard(s->mutex);
+  s->lost += lost;
+  s->calls += 2 * ROUNDS;
+}
+
+static void rates(void *context) {
+  shared_t *s = (shared_t *)context;
+  const ltr390_rate_t rate[] = {LTR390_RATE_25MS, LTR390_RATE_200MS,
+                                LTR390_RATE_2000MS};
+  uint32_t lost = 0;
+  for (uint32_t i = 0; i < ROUNDS; i++) {
+    s->ltr->setMeasurementRate(rate[i % 3]);
+    if (s->ltr->getMeasurementRate() != rate[i % 3]) {
+      lost++;
+    }
+  }
+  std::lock_guard<std::recursive_mutex> guard(s->mutex);
+  s->lost += lost;
+  s->calls += 2 * ROUNDS;
+}
+
+// The application's own code shares the lock too, here to move the
+// simulated time on between reads
+static void readings(void *context) {
+  shared_t *s = (shared_t *)context;
+  ltr390_sample_t sample;
+  for (uint32_t i = 0; i < ROUNDS; i++) {
+    s->mutex.lock();
+    s->sim->advance(5000);
+    s->mutex.unlock();
+    s->ltr->readNewData(&sample);
+    s->ltr->latchedStatus();
+    s->ltr->takeInterrupt();
+    s->ltr->takePowerOn();
+  }
+  std::lock_guard<std::recursive_mutex> guard(s->mutex);
+  s->calls += 4 * ROUNDS;
+}
+
+int main(void) {
+  Adafruit_LTR390_Sim sim;
+  Adafruit_LTR390 ltr;
+  ltr390_clock_t clock = sim.clock();
+  shared_t shared;
+  shared.ltr = &ltr;
+  shared.sim = &sim;
+  shared.lost = 0;
+  shared.calls = 0;
+  ltr390_bus_lock_t hook = {lock, unlock, &shared};
+
+  sim.setLight(20000, 2000);
+  ltr.setClock(&clock);
+  if (!ltr.beginTransport(&sim)) {
+    printf("lock check: begin failed\n");
+    return 1;
+  }
+  ltr.setBusLock(&hook);
+  ltr.resetLockStats();
+
+  Adafruit_LTR390_Thread threads[3];
+  threads[0].start(resolutions, &shared);
+  threads[1].start(rates, &shared);
+  threads[2].start(readings, &shared);
+  for (int i = 0; i < 3; i++) {
+    threads[i].join();
+  }
+
+  ltr390_lock_stats_t stats;
+  ltr.getLockStats(&stats);
+  printf("bus lock: %u calls, %u locked, %u lost updates\n", shared.calls,
+         stats.holds, shared.lost);
+  return (shared.lost || (stats.holds != shared.calls)) ? 1 : 0;
+}
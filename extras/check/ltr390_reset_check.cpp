@@ -0,0 +1,61 @@
+/*!
+ *  @file ltr390_reset_check.cpp
+ *
+ * 	Host check that a soft reset() is not taken for a brownout: the
+ * 	power-on flag it sets must not count in powerOnCount(), stay latched,
+ * 	or make the next status read restore the configuration. A real power
+ * 	cycle of the simulated sensor still must
+ *
+ * 	Build and run with 'make run' in this directory
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <Adafruit_LTR390.h>
+#include <Adafruit_LTR390_Sim.h>
+
+#include <stdio.h>
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+  if (!ok) {
+    printf("reset check failed: %s\n", what);
+    failures++;
+  }
+}
+
+int main(void) {
+  Adafruit_LTR390_Sim sim;
+  Adafruit_LTR390 ltr;
+  ltr390_clock_t clock = sim.clock();
+
+  sim.setLight(20000, 2000);
+  ltr.setClock(&clock);
+  expect(ltr.beginTransport(&sim), "begin");
+  expect(ltr.powerOnCount() == 0, "begin counted as a power-on");
+
+  expect(ltr.reset(), "reset");
+  expect(ltr.powerOnCount() == 0, "reset counted as a power-on");
+  expect(ltr.latchedStatus() == 0, "reset left status latched");
+  sim.advance(200000);
+  ltr.newDataAvailable();
+  ltr.readStatus();
+  expect(ltr.powerOnCount() == 0, "status read after reset saw a power-on");
+  expect(!ltr.takePowerOn(), "power-on flag taken after reset");
+
+  // the settings reset() left must stay, not be restored over
+  ltr.setGain(LTR390_GAIN_18);
+  ltr.reset();
+  ltr.readStatus();
+  expect(ltr.getGain() == LTR390_GAIN_3, "reset settings restored over");
+
+  sim.powerCycle();
+  sim.advance(10000);
+  ltr.readStatus();
+  expect(ltr.powerOnCount() == 1, "power cycle not counted");
+  expect(ltr.takePowerOn(), "power cycle flag not taken");
+
+  printf("reset: %s\n", failures ? "FAILED" : "no brownouts from soft resets");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+/*!
+ *  @file ltr390_sampler_check.cpp
+ *
+ * 	Host check of the Adafruit_LTR390_Sampler queue overflow policies. The
+ * 	sampler runs against a simulated sensor that has a new reading every
+ * 	time it is checked, into a queue too small to keep up, and nothing
+ * 	pops until it is stopped. With LTR390_OVERFLOW_DROP_OLDEST the queue
+ * 	must end up holding the last readings taken, with
+ * 	LTR390_OVERFLOW_DROP_NEWEST the first, in order, and dropped() must
+ * 	count every other reading
+ *
+ * 	Build and run with 'make run' in this directory
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <Adafruit_LTR390.h>
+#include <Adafruit_LTR390_Sampler.h>
+#include <Adafruit_LTR390_Sim.h>
+
+#include <stdio.h>
+#include <vector>
+
+#define CAPACITY 4  ///< Queue size in records
+#define OVERFLOW 20 ///< Readings to drop before stopping
+
+/*!
+ *    @brief  Simulated sensor that moves time on to the next conversion at
+ *            each status check, and logs when each new reading was read.
+ *            Only the sampler's task calls it
+ */
+class TickingSensor {
+public:
+  /*!  @brief  Reads registers, see Adafruit_LTR390_Sim::read()  */
+  bool read(uint8_t reg, uint8_t *buffer, size_t len) {
+    if (reg == LTR390_MAIN_STATUS) {
+      sim.advance(sim.nextConversionIn() + 100);
+    }
+    bool ok = sim.read(reg, buffer, len);
+    if (ok && (reg == LTR390_MAIN_STATUS) && (len > 1) &&
+        (buffer[0] & LTR390_STATUS_DATA)) {
+      readings.push_back((uint32_t)sim.micros());
+    }
+    return ok;
+  }
+  /*!  @brief  Writes registers, see Adafruit_LTR390_Sim::write()  */
+  bool write(uint8_t reg, const uint8_t *buffer, size_t len) {
+    return sim.write(reg, buffer, len);
+  }
+
+  Adafruit_LTR390_Sim sim;        ///< The sensor
+  std::vector<uint32_t> readings; ///< Virtual time of each new reading
+};
+
+static int failures = 0;
+
+static void expect(bool ok, const char *policy, const char *what) {
+  if (!ok) {
+    printf("sampler check failed, %s: %s\n", policy, what);
+    failures++;
+  }
+}
+
+static void check(ltr390_overflow_t policy, const char *name) {
+  TickingSensor sensor;
+  Adafruit_LTR390 ltr;
+  ltr390_clock_t clock = sensor.sim.clock();
+  ltr390_record_t buffer[CAPACITY];
+
+  sensor.sim.setLight(20000, 2000);
+  ltr.setClock(&clock);
+  ltr.beginTransport(&sensor);
+  ltr.setResolution(LTR390_RESOLUTION_13BIT);
+  ltr.setMeasurementRate(LTR390_RATE_25MS);
+  sensor.readings.clear();
+
+  Adafruit_LTR390_Sampler sampler(&ltr, buffer, CAPACITY, policy);
+  expect(sampler.start(1), name, "start");
+  for (int i = 0; (i < 5000) && (sampler.dropped() < OVERFLOW); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  sampler.stop();
+
+  // the task has finished, so its log is safe to read
+  const std::vector<uint32_t> &taken = sensor.readings;
+  expect(taken.size() >= CAPACITY + OVERFLOW, name, "too few readings");
+  expect(sampler.available() == CAPACITY, name, "queue not full");
+  expect(sampler.dropped() == taken.size() - CAPACITY, name,
+         "dropped() does not count every reading left out");
+
+  size_t first = (policy == LTR390_OVERFLOW_DROP_OLDEST)
+                     ? taken.size() - CAPACITY
+                     : 0;
+  ltr390_record_t record;
+  for (size_t i = 0; i < CAPACITY; i++) {
+    if (!sampler.pop(&record)) {
+      expect(false, name, "pop failed");
+      break;
+    }
+    expect(record.micros == taken[first + i], name,
+           (policy == LTR390_OVERFLOW_DROP_OLDEST)
+               ? "queue does not hold the newest readings in order"
+               : "queue does not hold the oldest readings in order");
+  }
+  expect(!sampler.pop(&record), name, "more than CAPACITY queued");
+
+  printf("sampler %s: %u readings, %u queued, %u dropped\n", name,
+         (unsigned)taken.size(), CAPACITY, sampler.dropped());
+}
+
+int main(void) {
+  check(LTR390_OVERFLOW_DROP_OLDEST, "drop oldest");
+  check(LTR390_OVERFLOW_DROP_NEWEST, "drop newest");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+/*!
+ *  @file ltr390_snapshot_stress.cpp
+ *
+ * 	Host stress check of getSnapshot(): one thread reads the simulated
+ * 	sensor as fast as it can, publishing every reading, while the others
+ * 	take snapshots. The writer's run is deterministic, so it is made once
+ * 	alone to log the snapshot after each reading, then again with the
+ * 	readers, and every snapshot they get must equal the logged one with
+ * 	the same sequence. A snapshot that matches none is torn
+ *
+ * 	Build and run with 'make run' in this directory. It also runs clean
+ * 	under ThreadSanitizer, build it with
+ * 	make clean run CXXFLAGS='-O1 -g -std=c++11 -fsanitize=thread'
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <Adafruit_LTR390.h>
+#include <Adafruit_LTR390_Sim.h>
+#include <Adafruit_LTR390_Thread.h>
+
+#include <atomic>
+#include <stdio.h>
+#include <vector>
+
+#define READINGS 200000 ///< Readings the writer publishes
+#define READERS 3       ///< Threads taking snapshots
+
+/*!    @brief  One thread's view of the run  */
+typedef struct {
+  Adafruit_LTR390 *ltr;                      ///< The driver being read
+  const std::vector<ltr390_snapshot_t> *log; ///< Snapshot by sequence
+  std::atomic<bool> *done;                   ///< Set when the writer is done
+  uint32_t snapshots;                        ///< Consistent copies returned
+  uint32_t busy;                             ///< getSnapshot() gave up
+  uint32_t torn;                             ///< Copies matching no reading
+  uint32_t backwards;                        ///< Sequence went down
+} worker_t;
+
+static bool same(const ltr390_reading_t *a, const ltr390_reading_t *b) {
+  return (a->valid == b->valid) && (a->counts == b->counts) &&
+         (a->flags == b->flags) && (a->micros == b->micros) &&
+         (a->gain == b->gain) && (a->resolution == b->resolution);
+}
+
+// The writer: reads on every conversion, switching mode and gain now and
+// then so each field of the snapshot changes
+static void drive(Adafruit_LTR390 *ltr, Adafruit_LTR390_Sim *sim,
+                  std::vector<ltr390_snapshot_t> *log) {
+  const ltr390_gain_t gains[] = {LTR390_GAIN_1, LTR390_GAIN_3, LTR390_GAIN_18};
+  ltr390_clock_t clock = sim->clock();
+  ltr390_sample_t sample;
+  ltr390_snapshot_t snapshot;
+
+  sim->setLight(20000, 2000);
+  ltr->setClock(&clock);
+  ltr->beginTransport(sim);
+  ltr->setResolution(LTR390_RESOLUTION_13BIT);
+  ltr->setMeasurementRate(LTR390_RATE_25MS);
+  if (log) {
+    ltr->getSnapshot(&snapshot);
+    log->push_back(snapshot);
+  }
+
+  for (uint32_t i = 0; i < READINGS; i++) {
+    if ((i % 64) == 63) {
+      ltr->setMode((i & 64) ? LTR390_MODE_UVS : LTR390_MODE_ALS);
+      ltr->setGain(gains[(i / 64) % 3]);
+    }
+    sim->advance(sim->nextConversionIn() + 100);
+    ltr->readNewData(&sample);
+    if (log) {
+      ltr->getSnapshot(&snapshot);
+      log->resize(snapshot.sequence + 1, snapshot);
+    }
+  }
+}
+
+static void writer(void *context) {
+  worker_t *r = (worker_t *)context;
+  Adafruit_LTR390_Sim sim;
+  drive(r->ltr, &sim, NULL);
+  *r->done = true;
+}
+
+static void reader(void *context) {
+  worker_t *r = (worker_t *)context;
+  uint32_t last = 0;
+
+  while (!*r->done) {
+    ltr390_snapshot_t snapshot;
+    if (!r->ltr->getSnapshot(&snapshot)) {
+      r->busy++;
+      continue;
+    }
+    r->snapshots++;
+    if (snapshot.sequence < last) {
+      r->backwards++;
+    }
+    last = snapshot.sequence;
+    const ltr390_snapshot_t *want = NULL;
+    if (snapshot.sequence < r->log->size()) {
+      want = &(*r->log)[snapshot.sequence];
+    }
+    if (!want || !same(&snapshot.als, &want->als) ||
+        !same(&snapshot.uvs, &want->uvs)) {
+      r->torn++;
+    }
+  }
+}
+
+int main(void) {
+  std::vector<ltr390_snapshot_t> log;
+  {
+    Adafruit_LTR390_Sim sim;
+    Adafruit_LTR390 ltr;
+    drive(&ltr, &sim, &log);
+  }
+
+  Adafruit_LTR390 ltr;
+  std::atomic<bool> done(false);
+  worker_t workers[READERS + 1] = {};
+  Adafruit_LTR390_Thread threads[READERS + 1];
+  for (int i = 0; i <= READERS; i++) {
+    workers[i].ltr = &ltr;
+    workers[i].log = &log;
+    workers[i].done = &done;
+  }
+  // readers first, so they are already spinning when readings start
+  for (int i = 1; i <= READERS; i++) {
+    threads[i].start(reader, &workers[i]);
+  }
+  threads[0].start(writer, &workers[0]);
+
+  uint32_t snapshots = 0, busy = 0, torn = 0, backwards = 0;
+  for (int i = 0; i <= READERS; i++) {
+    threads[i].join();
+    snapshots += workers[i].snapshots;
+    busy += workers[i].busy;
+    torn += workers[i].torn;
+    backwards += workers[i].backwards;
+  }
+
+  printf("snapshot stress: %u readings, %u snapshots, %u busy, %u torn, "
+         "%u out of order\n",
+         (unsigned)(log.size() - 1), snapshots, busy, torn, backwards);
+  return (torn || backwards) ? 1 : 0;
+}
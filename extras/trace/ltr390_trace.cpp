@@ -0,0 +1,311 @@
+/*!
+ *  @file ltr390_trace.cpp
+ *
+ * 	Host tool for LTR390 bus traces dumped by Adafruit_LTR390_Trace
+ *
+ * 	ltr390_trace summary <file>  per-register counts, bytes, NACKs, timing
+ * 	ltr390_trace decode <file>   one line per transaction
+ * 	ltr390_trace replay <file>   run the driver calls the trace came from
+ * 	                             against the recorded data
+ *
+ * 	Build with 'make' in this directory
+ *
+ * 	BSD (see license.txt)
+ */
+
+#include <Adafruit_LTR390.h>
+#include <Adafruit_LTR390_Trace.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const char *reg_name(uint8_t reg) {
+  switch (reg) {
+  case LTR390_MAIN_CTRL:
+    return "MAIN_CTRL";
+  case LTR390_MEAS_RATE:
+    return "MEAS_RATE";
+  case LTR390_GAIN:
+    return "GAIN";
+  case LTR390_PART_ID:
+    return "PART_ID";
+  case LTR390_MAIN_STATUS:
+    return "MAIN_STATUS";
+  case LTR390_ALSDATA:
+    return "ALS_DATA";
+  case LTR390_UVSDATA:
+    return "UVS_DATA";
+  case LTR390_INT_CFG:
+    return "INT_CFG";
+  case LTR390_INT_PST:
+    return "INT_PST";
+  case LTR390_THRESH_UP:
+    return "THRESH_UP";
+  case LTR390_THRESH_LOW:
+    return "THRESH_LOW";
+  default:
+    return "?";
+  }
+}
+
+static bool load(const char *path, std::vector<uint8_t> *trace) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return false;
+  }
+  uint8_t buf[512];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    trace->insert(trace->end(), buf, buf + n);
+  }
+  fclose(f);
+  return true;
+}
+
+static int summary(const std::vector<uint8_t> &trace) {
+  uint32_t count[256][2] = {{0}}, bytes[256][2] = {{0}};
+  uint32_t records = 0, nacks = 0, first = 0, last = 0, max_gap = 0;
+  ltr390_trace_record_t rec;
+  size_t pos = 0, next;
+
+  while ((next = Adafruit_LTR390_Trace::parse(trace.data(), trace.size(), pos,
+                                              &rec)) != 0) {
+    if (records == 0) {
+      first = rec.micros;
+    } else if (rec.micros - last > max_gap) {
+      max_gap = rec.micros - last;
+    }
+    last = rec.micros;
+    count[rec.reg][rec.write]++;
+    bytes[rec.reg][rec.write] += rec.len;
+    nacks += !rec.ack;
+    records++;
+    pos = next;
+  }
+
+  double span = (last - first) / 1e6;
+  printf("%u transactions, %u failed, over %.3f s", records, nacks, span);
+  if (span > 0) {
+    printf(" (%.1f/s)", records / span);
+  }
+  printf(", longest gap %u us\n\n", max_gap);
+  printf("%-12s %4s %8s %8s %8s %8s\n", "register", "addr", "reads", "rd B",
+         "writes", "wr B");
+  for (int r = 0; r < 256; r++) {
+    if (count[r][0] || count[r][1]) {
+      printf("%-12s 0x%02X %8u %8u %8u %8u\n", reg_name(r), r, count[r][0],
+             bytes[r][0], count[r][1], bytes[r][1]);
+    }
+  }
+  if (pos != trace.size()) {
+    printf("\n%u trailing bytes are not a complete record\n",
+           (unsigned)(trace.size() - pos));
+  }
+  return 0;
+}
+
+static int decode(const std::vector<uint8_t> &trace) {
+  ltr390_trace_record_t rec;
+  size_t pos = 0, next;
+  uint32_t first = 0;
+  bool have_first = false;
+
+  while ((next = Adafruit_LTR390_Trace::parse(trace.data(), trace.size(), pos,
+                                              &rec)) != 0) {
+    if (!have_first) {
+      first = rec.micros;
+      have_first = true;
+    }
+    printf("%10u us %s %-11s %s", rec.micros - first,
+           rec.write ? "W" : "R", reg_name(rec.reg), rec.ack ? "  " : "NA");
+    for (uint8_t i = 0; i < rec.len; i++) {
+      printf(" %02X", rec.data[i]);
+    }
+    printf("\n");
+    pos = next;
+  }
+  return 0;
+}
+
+// Check for the read-modify-write of one register that writeBits() makes
+static bool rmw(Adafruit_LTR390_TraceReplay *replayer, uint8_t reg,
+                uint8_t ahead, uint8_t *written) {
+  ltr390_trace_record_t rd, wr;
+  if (!replayer->peek(&rd, ahead) || !replayer->peek(&wr, ahead + 1)) {
+    return false;
+  }
+  if (rd.write || (rd.reg != reg) || (rd.len != 1) || !wr.write ||
+      (wr.reg != reg) || (wr.len != 1)) {
+    return false;
+  }
+  *written = wr.data[0];
+  return true;
+}
+
+static uint32_t threshold(const ltr390_trace_record_t *rec) {
+  return rec->data[0] | ((uint32_t)rec->data[1] << 8) |
+         ((uint32_t)(rec->data[2] & 0x0F) << 16);
+}
+
+static int replay(const std::vector<uint8_t> &trace) {
+  Adafruit_LTR390_TraceReplay replayer(trace.data(), trace.size());
+  ltr390_clock_t clock = replayer.clock();
+  Adafruit_LTR390 ltr;
+  ltr.setClock(&clock);
+  ltr390_sample_t sample;
+  ltr390_trace_record_t rec;
+  uint32_t unmapped = 0;
+
+  // the driver has to go through begin() before anything else, so a ring
+  // that has wrapped is replayed from the first begin() still in it
+  while (replayer.peek(&rec) && (rec.write || (rec.reg != LTR390_PART_ID))) {
+    replayer.skip();
+    unmapped++;
+  }
+  if (unmapped) {
+    printf("skipped %u transactions before the first begin()\n", unmapped);
+    unmapped = 0;
+  }
+
+  // work out which driver call made each group of records, and make it, so
+  // the driver's own state (mode, gain, resolution) follows the trace
+  while (replayer.peek(&rec)) {
+    uint32_t before = replayer.mismatches();
+    ltr390_trace_record_t rec2;
+    uint8_t value, source, persist;
+
+    if (!rec.write && (rec.reg == LTR390_PART_ID)) {
+      // begin() at a set bus clock probes it with PART_ID reads first, so
+      // leave begin() its own read and the failed tries just before it
+      uint8_t probes = 0;
+      bool ack = rec.ack;
+      for (uint8_t ahead = 1; replayer.peek(&rec2, ahead) && !rec2.write &&
+                              (rec2.reg == LTR390_PART_ID);
+           ahead++) {
+        if (ack) {
+          probes = ahead;
+        }
+        ack = rec2.ack;
+      }
+      for (uint8_t i = 0; i < probes; i++) {
+        replayer.skip();
+      }
+      if (probes) {
+        printf("%10u bus clock probe, %u reads\n", replayer.micros(), probes);
+      }
+      bool ok = ltr.beginTransport(&replayer);
+      printf("%10u begin() -> %s\n", replayer.micros(), ok ? "ok" : "failed");
+    } else if (!rec.write && (rec.reg == LTR390_MAIN_STATUS) &&
+               (rec.len > 1)) {
+      bool fresh = ltr.readNewData(&sample);
+      printf("%10u readNewData() -> %s", replayer.micros(),
+             fresh ? "" : "no data\n");
+      if (fresh) {
+        printf("%u flags 0x%02X\n", sample.counts, sample.flags);
+      }
+    } else if (!rec.write && (rec.reg == LTR390_MAIN_STATUS)) {
+      bool ready = ltr.newDataAvailable();
+      printf("%10u newDataAvailable() -> %d\n", replayer.micros(), ready);
+    } else if (!rec.write && (rec.reg == LTR390_ALSDATA)) {
+      ltr.readALS(&sample);
+      printf("%10u readALS() -> %u flags 0x%02X\n", replayer.micros(),
+             sample.counts, sample.flags);
+    } else if (!rec.write && (rec.reg == LTR390_UVSDATA)) {
+      ltr.readUVS(&sample);
+      printf("%10u readUVS() -> %u flags 0x%02X\n", replayer.micros(),
+             sample.counts, sample.flags);
+    } else if (rmw(&replayer, LTR390_MAIN_CTRL, 0, &value)) {
+      uint8_t was = rec.data[0];
+      if (value & 0x10) {
+        bool ok = ltr.reset();
+        printf("%10u reset() -> %s\n", replayer.micros(), ok ? "ok" : "failed");
+      } else if ((was ^ value) & 0x08) {
+        ltr.setMode((value & 0x08) ? LTR390_MODE_UVS : LTR390_MODE_ALS);
+        printf("%10u setMode(%s)\n", replayer.micros(),
+               (value & 0x08) ? "UVS" : "ALS");
+      } else {
+        ltr.enable(value & 0x02);
+        printf("%10u enable(%d)\n", replayer.micros(), (value & 0x02) != 0);
+      }
+    } else if (rmw(&replayer, LTR390_GAIN, 0, &value)) {
+      ltr.setGain((ltr390_gain_t)(value & 0x07));
+      printf("%10u setGain(%u)\n", replayer.micros(), value & 0x07);
+    } else if (rmw(&replayer, LTR390_MEAS_RATE, 0, &value)) {
+      if ((rec.data[0] ^ value) & 0x70) {
+        ltr.setResolution((ltr390_resolution_t)((value >> 4) & 0x07));
+        printf("%10u setResolution(%u)\n", replayer.micros(),
+               (value >> 4) & 0x07);
+      } else {
+        ltr.setMeasurementRate((ltr390_rate_t)(value & 0x07));
+        printf("%10u setMeasurementRate(%u)\n", replayer.micros(),
+               value & 0x07);
+      }
+    } else if (rmw(&replayer, LTR390_INT_CFG, 0, &value) &&
+               rmw(&replayer, LTR390_INT_CFG, 2, &source) &&
+               rmw(&replayer, LTR390_INT_PST, 4, &persist)) {
+      ltr390_mode_t mode =
+          (((source >> 4) & 0x03) == 3) ? LTR390_MODE_UVS : LTR390_MODE_ALS;
+      ltr.configInterrupt(value & 0x04, mode, persist >> 4);
+      printf("%10u configInterrupt(%d, %s, %u)\n", replayer.micros(),
+             (value & 0x04) != 0, (mode == LTR390_MODE_UVS) ? "UVS" : "ALS",
+             persist >> 4);
+    } else if (rec.write && (rec.reg == LTR390_THRESH_LOW) &&
+               (rec.len == 3) && replayer.peek(&rec2, 1) && rec2.write &&
+               (rec2.reg == LTR390_THRESH_UP) && (rec2.len == 3)) {
+      uint32_t lower = threshold(&rec), higher = threshold(&rec2);
+      ltr.setThresholds(lower, higher);
+      printf("%10u setThresholds(%u, %u)\n", replayer.micros(), lower,
+             higher);
+    } else if (!rec.write && (rec.len == 1) &&
+               (rec.reg == LTR390_MAIN_CTRL)) {
+      // enabled() reads the same register, either call replays it
+      ltr390_mode_t mode = ltr.getMode();
+      printf("%10u getMode() -> %s\n", replayer.micros(),
+             (mode == LTR390_MODE_UVS) ? "UVS" : "ALS");
+    } else if (!rec.write && (rec.len == 1) && (rec.reg == LTR390_GAIN)) {
+      printf("%10u getGain() -> %u\n", replayer.micros(), ltr.getGain());
+    } else if (!rec.write && (rec.len == 1) &&
+               (rec.reg == LTR390_MEAS_RATE)) {
+      printf("%10u getResolution() -> %u\n", replayer.micros(),
+             ltr.getResolution());
+    } else {
+      // anything else is replayed as a raw transaction
+      replayer.skip();
+      printf("%10u %s %s\n", replayer.micros(), rec.write ? "write" : "read",
+             reg_name(rec.reg));
+      unmapped++;
+    }
+
+    if (replayer.mismatches() != before) {
+      printf("           ^ driver diverged from the trace\n");
+      replayer.skip();
+    }
+  }
+
+  printf("\n%u mismatches, %u raw transactions\n", replayer.mismatches(),
+         unmapped);
+  return replayer.mismatches() ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  std::vector<uint8_t> trace;
+
+  if ((argc != 3) || !load(argv[2], &trace)) {
+    fprintf(stderr, "usage: %s summary|decode|replay <trace file>\n",
+            argv[0]);
+    return 2;
+  }
+  if (strcmp(argv[1], "summary") == 0) {
+    return summary(trace);
+  }
+  if (strcmp(argv[1], "decode") == 0) {
+    return decode(trace);
+  }
+  if (strcmp(argv[1], "replay") == 0) {
+    return replay(trace);
+  }
+  fprintf(stderr, "unknown command %s\n", argv[1]);
+  return 2;
+}